@@ -0,0 +1,164 @@
+/*
+ * adc_dma.h
+ *
+ * Aquisição do ADC12 por DMA em blocos de N sequências, com a média feita no laço principal.
+ * A CPU acorda uma vez por bloco, e não a cada sequência.
+ *
+ * O gatilho ADC12IFGx do DMA, em modo de sequência, só dispara no fim da sequência (EOS).
+ * Dois canais usam o mesmo gatilho:
+ *  - DMA0 (bloco repetido): copia ADC12MEM0..MEMn para a posição seguinte do buffer. No fim
+ *    de cada bloco o destino é recarregado de DMA0DA;
+ *  - DMA1 (simples repetido, prioridade menor): escreve em DMA0DA o endereço da posição
+ *    seguinte, tirado de uma tabela. Depois de N sequências, a interrupção do DMA1 avisa
+ *    que um bloco está pronto.
+ * O buffer tem duas metades (ping-pong): o laço principal tem N sequências para fazer a média
+ * de um bloco antes de o DMA voltar a ele.
+ *
+ * Cada sequência ocupa ADC_DMA_CONVERSIONS palavras, canal por canal (MEM0..3 = canal 0, ...),
+ * como no ADC12MCTLx do experimento.
+ *
+ * Antes de incluir: msp430.h. O experimento configura o ADC com ADC12IE = 0 (quem lê as
+ * MEMx é o DMA) e chama adc_dma_start antes de ligar o ADC12ENC.
+ *
+ * Parâmetros (todos opcionais, padrão entre parênteses):
+ *   ADC_DMA_CHANNELS (4)
+ *   ADC_DMA_CHANNEL_SHIFT (2)      2^k conversões por canal em cada sequência
+ *   ADC_DMA_BLOCK_SHIFT (3)        N = 2^k sequências por bloco
+ *   ADC_DMA_OVERSAMPLING (ADC_DMA_BLOCK_SHIFT, ...)
+ *                                  Por canal, separados por vírgula (sem chaves), até 16:
+ *                                  média das últimas 2^k sequências do bloco, k <= ADC_DMA_BLOCK_SHIFT
+ *
+ * O driver usa os canais 0 e 1 do DMA e a interrupção DMA_VECTOR.
+ */
+
+#ifndef ADC_DMA_H_
+#define ADC_DMA_H_
+
+#ifndef ADC_DMA_CHANNELS
+#define ADC_DMA_CHANNELS 4
+#endif
+#ifndef ADC_DMA_CHANNEL_SHIFT
+#define ADC_DMA_CHANNEL_SHIFT 2
+#endif
+#ifndef ADC_DMA_BLOCK_SHIFT
+#define ADC_DMA_BLOCK_SHIFT 3
+#endif
+#ifndef ADC_DMA_OVERSAMPLING
+#define ADC_DMA_OVERSAMPLING ADC_DMA_BLOCK_SHIFT, ADC_DMA_BLOCK_SHIFT, ADC_DMA_BLOCK_SHIFT, ADC_DMA_BLOCK_SHIFT
+#endif
+
+#define ADC_DMA_CONVERSIONS (ADC_DMA_CHANNELS << ADC_DMA_CHANNEL_SHIFT)  // Palavras por sequência
+#define ADC_DMA_BLOCK_SEQUENCES (1 << ADC_DMA_BLOCK_SHIFT)
+// Posição s (0..2N-1) do buffer: metade s / N, sequência s % N
+#define ADC_DMA_SLOT(s) adc_dma_buffer[(s) >> ADC_DMA_BLOCK_SHIFT][(s) & (ADC_DMA_BLOCK_SEQUENCES - 1)]
+
+typedef char adc_dma_too_many_conversions[(ADC_DMA_CONVERSIONS <= 16)? 1 : -1]; // ADC12MEM0..15
+
+// Cada profundidade cabe no bloco (senão adc_dma_average leria antes do início do bloco).
+// A lista é completada com zeros até 16 canais, o máximo com ADC_DMA_CONVERSIONS <= 16.
+#define ADC_DMA_DEPTH_OK(k) ((k) <= ADC_DMA_BLOCK_SHIFT)
+#define ADC_DMA_DEPTHS_OK(...) ADC_DMA_DEPTHS_OK_(__VA_ARGS__, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0)
+#define ADC_DMA_DEPTHS_OK_(a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p, ...) \
+    (ADC_DMA_DEPTH_OK(a) && ADC_DMA_DEPTH_OK(b) && ADC_DMA_DEPTH_OK(c) && ADC_DMA_DEPTH_OK(d) && \
+     ADC_DMA_DEPTH_OK(e) && ADC_DMA_DEPTH_OK(f) && ADC_DMA_DEPTH_OK(g) && ADC_DMA_DEPTH_OK(h) && \
+     ADC_DMA_DEPTH_OK(i) && ADC_DMA_DEPTH_OK(j) && ADC_DMA_DEPTH_OK(k) && ADC_DMA_DEPTH_OK(l) && \
+     ADC_DMA_DEPTH_OK(m) && ADC_DMA_DEPTH_OK(n) && ADC_DMA_DEPTH_OK(o) && ADC_DMA_DEPTH_OK(p))
+typedef char adc_dma_oversampling_deeper_than_block[ADC_DMA_DEPTHS_OK(ADC_DMA_OVERSAMPLING)? 1 : -1];
+
+// Estado ==============================================================================
+unsigned int adc_dma_buffer[2][ADC_DMA_BLOCK_SEQUENCES][ADC_DMA_CONVERSIONS];
+unsigned int adc_dma_table[2 * ADC_DMA_BLOCK_SEQUENCES];  // Próximo DMA0DA, lido pelo DMA1
+const unsigned char adc_dma_oversampling_shift[ADC_DMA_CHANNELS] = { ADC_DMA_OVERSAMPLING };
+
+volatile unsigned int adc_dma_blocks = 0;      // Blocos completos (só a ISR escreve)
+unsigned int adc_dma_consumed = 0;             // Blocos já processados (só o laço principal escreve)
+volatile unsigned int adc_dma_overruns = 0;    // Blocos perdidos: o laço principal não acompanhou
+
+void adc_dma_start();
+unsigned char adc_dma_block_ready();
+void adc_dma_average(unsigned int* values);
+
+// Implementação ======================================================================
+void adc_dma_start()
+{
+    int i;
+
+    // A sequência k vai para a posição k (de 2N). Na sequência k o DMA1 escreve a posição
+    // k + 2: o DMA0 já recarregou o destino da k + 1 no fim do próprio bloco.
+    for (i = 0; i < 2 * ADC_DMA_BLOCK_SEQUENCES; i++) {
+        adc_dma_table[i] = (unsigned int) ADC_DMA_SLOT((i + 2) % (2 * ADC_DMA_BLOCK_SEQUENCES));
+    }
+    adc_dma_blocks = 0;
+    adc_dma_consumed = 0;
+
+    DMACTL0 = DMA1TSEL_24 | DMA0TSEL_24; // ADC12IFGx (fim da sequência) para os dois
+    DMACTL4 = DMARMWDIS;                 // Não interromper read-modify-write da CPU
+
+    // DMA0: ADC12MEM0..n -> posição atual, o bloco inteiro a cada gatilho
+    __data16_write_addr((unsigned short) &DMA0SA, (unsigned long) &ADC12MEM0);
+    __data16_write_addr((unsigned short) &DMA0DA, (unsigned long) ADC_DMA_SLOT(0));
+    DMA0SZ = ADC_DMA_CONVERSIONS;
+    DMA0CTL = DMADT_5 | DMASRCINCR_3 | DMADSTINCR_3 | DMAEN;
+    // Com o canal ligado, DMA0DA já vale para a recarga no fim do primeiro bloco
+    __data16_write_addr((unsigned short) &DMA0DA, (unsigned long) ADC_DMA_SLOT(1));
+
+    // DMA1: tabela -> DMA0DA, uma palavra por sequência; interrupção a cada N
+    __data16_write_addr((unsigned short) &DMA1SA, (unsigned long) &adc_dma_table[0]);
+    __data16_write_addr((unsigned short) &DMA1DA, (unsigned long) &DMA0DA);
+    DMA1SZ = ADC_DMA_BLOCK_SEQUENCES;
+    DMA1CTL = DMADT_4 | DMASRCINCR_3 | DMADSTINCR_0 | DMAIE | DMAEN;
+    // Recarga no fim do primeiro bloco: segunda metade da tabela
+    __data16_write_addr((unsigned short) &DMA1SA, (unsigned long) &adc_dma_table[ADC_DMA_BLOCK_SEQUENCES]);
+}
+
+unsigned char adc_dma_block_ready()
+{
+    return adc_dma_blocks != adc_dma_consumed;
+}
+
+/*
+ * Média do último bloco completo. Cada canal soma as conversões das últimas 2^k sequências
+ * (k = profundidade do canal) e devolve o valor na resolução do ADC.
+ * Precisa terminar antes de o DMA voltar a esta metade: N sequências.
+ */
+void adc_dma_average(unsigned int* values)
+{
+    unsigned int blocks = adc_dma_blocks;
+    if (blocks - adc_dma_consumed > 1) {
+        adc_dma_overruns += blocks - adc_dma_consumed - 1;
+    }
+    adc_dma_consumed = blocks;
+
+    unsigned int (*block)[ADC_DMA_CONVERSIONS] = adc_dma_buffer[(blocks - 1) & 1];
+    int channel, sequence, i;
+    for (channel = 0; channel < ADC_DMA_CHANNELS; channel++) {
+        unsigned char depth = adc_dma_oversampling_shift[channel];
+        unsigned long sum = 0;
+        for (sequence = ADC_DMA_BLOCK_SEQUENCES - (1 << depth); sequence < ADC_DMA_BLOCK_SEQUENCES; sequence++) {
+            for (i = 0; i < (1 << ADC_DMA_CHANNEL_SHIFT); i++) {
+                sum += block[sequence][(channel << ADC_DMA_CHANNEL_SHIFT) + i];
+            }
+        }
+        values[channel] = sum >> (depth + ADC_DMA_CHANNEL_SHIFT);
+    }
+}
+
+// Interrupção =========================================================================
+#pragma vector = DMA_VECTOR
+__interrupt void __adc_dma_interrupt(void)
+{
+    switch(__even_in_range(DMAIV, 16)) {
+    case DMAIV_DMA1IFG:
+        // Bloco completo. O DMA1 já recarregou a outra metade da tabela; a próxima
+        // recarga volta para a metade do bloco que acabou de fechar.
+        __data16_write_addr((unsigned short) &DMA1SA,
+                            (unsigned long) &adc_dma_table[(adc_dma_blocks & 1) * ADC_DMA_BLOCK_SEQUENCES]);
+        adc_dma_blocks++;
+        __bic_SR_register_on_exit(LPM0_bits);
+        break;
+    default:
+        break;
+    }
+}
+
+#endif /* ADC_DMA_H_ */
@@ -0,0 +1,70 @@
+/*
+ * adc_snapshot.h
+ *
+ * Cópia consistente das medidas entre a ISR do ADC e o laço principal, sem desligar
+ * interrupções.
+ *
+ * A ISR é a única escritora e o leitor nunca a interrompe, então basta um contador de
+ * sequência: a ISR grava todos os canais e só depois incrementa o contador (O(1), sem laço
+ * de espera). O leitor copia os canais entre duas leituras do contador; se elas diferem,
+ * a ISR publicou no meio da cópia e a cópia é refeita. Uma sequência do ADC leva ms e a
+ * cópia alguns us, então a repetição é rara e nunca mais de uma em seguida. Com escritor e
+ * leitor no mesmo contexto (Exp10 com DMA) a cópia nunca repete.
+ *
+ * Tests/adc_snapshot_test.c confere no PC, com um sinal no papel da ISR, que nenhuma cópia
+ * sai com canais de conjuntos diferentes.
+ *
+ * Parâmetros (opcional, padrão entre parênteses):
+ *   ADC_SNAPSHOT_CHANNELS (4)
+ */
+
+#ifndef ADC_SNAPSHOT_H_
+#define ADC_SNAPSHOT_H_
+
+#ifndef ADC_SNAPSHOT_CHANNELS
+#define ADC_SNAPSHOT_CHANNELS 4
+#endif
+
+typedef struct {
+    volatile unsigned int sequence;  // Incrementado a cada conjunto publicado
+    volatile unsigned int values[ADC_SNAPSHOT_CHANNELS];
+} AdcSnapshot;
+
+volatile unsigned int adc_snapshot_retries = 0; // Cópias refeitas (para o debugger)
+
+void adc_snapshot_publish(AdcSnapshot* snapshot, const unsigned int* values);
+unsigned int adc_snapshot_read(AdcSnapshot* snapshot, unsigned int* values);
+
+/*
+ * Só na ISR (ou com interrupções desligadas): um único escritor.
+ */
+void adc_snapshot_publish(AdcSnapshot* snapshot, const unsigned int* values)
+{
+    int i;
+    for (i = 0; i < ADC_SNAPSHOT_CHANNELS; i++) {
+        snapshot->values[i] = values[i];
+    }
+    snapshot->sequence++;
+}
+
+/*
+ * Copia um conjunto completo (todos os canais da mesma sequência) e devolve o número
+ * da sequência, para o leitor saber se há dados novos.
+ */
+unsigned int adc_snapshot_read(AdcSnapshot* snapshot, unsigned int* values)
+{
+    unsigned int sequence = snapshot->sequence;
+    int i;
+    while (1) {
+        for (i = 0; i < ADC_SNAPSHOT_CHANNELS; i++) {
+            values[i] = snapshot->values[i];
+        }
+        if (sequence == snapshot->sequence) {
+            return sequence;
+        }
+        sequence = snapshot->sequence;
+        adc_snapshot_retries++;
+    }
+}
+
+#endif /* ADC_SNAPSHOT_H_ */
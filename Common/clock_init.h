@@ -0,0 +1,288 @@
+/*
+ * clock_init.h
+ *
+ * Partida dos clocks, compartilhada pelos experimentos que usam a árvore
+ * ACLK = XT1 (32768 Hz), SMCLK = XT2 (4 MHz), MCLK = DCO (25 MHz).
+ *
+ * clockInit não espera os cristais: o main começa a trabalhar em DCO/REFO com os mesmos
+ * clocks nominais, e a troca para os cristais acontece em segundo plano (no TB0).
+ * clockInitBlocking é a partida original, que espera tudo, para comparação.
+ *
+ * Medida da partida (RTC_A em modo contador, ACLK): a contagem começa na primeira linha de
+ * clockInit/clockInitBlocking, logo depois de parar o WDT, e é lida no debugger:
+ *   clock_ready_ticks      até a partida voltar para o main (o trabalho começa)
+ *   clock_crystal_ticks    até os cristais assumirem
+ * em ticks de 30,5 us. O tempo do reset até o main (cstartup) é o mesmo nas duas partidas
+ * e fica de fora.
+ *
+ * Antes de incluir: msp430.h. O header usa o TB0 (CCR0), o UNMI e o RTC_A; o experimento
+ * não pode usá-los.
+ * O UNMI não é mascarado pelo GIE, então ele só desliga o OFIE e arma o TB0. A troca
+ * (3 níveis de VCore, cada um esperando o SVM, mais ~1 ms de espera do FLL)
+ * roda inteira na interrupção do TB0: atrasa as outras interrupções uma vez, mas nunca
+ * entra no meio de uma ISR nem de uma seção crítica.
+ *
+ * Parâmetros (opcional):
+ *   CLOCK_ON_CRYSTALS_HOOK()   Chamado quando os cristais assumem (power.h começa a contagem)
+ */
+
+#ifndef CLOCK_INIT_H_
+#define CLOCK_INIT_H_
+
+#define FLLN(x) ((x)-1)
+#define CLOCK_RETRY_TICKS 33 // ~1 ms em ACLK (REFO) entre tentativas
+
+// Referência do FLL: XT2 / 4 = 1 MHz. Pior caso para o DCO assentar depois de mudar o
+// FLLN: n * 32 * 32 ciclos da referência (n = 1 com FLLD = 1), contados em ciclos do
+// MCLK = XT2 enquanto espera: 32 * 32 * 4 = 4096 ciclos ~ 1 ms.
+#define CLOCK_FLL_REFDIV 4
+#define CLOCK_FLL_SETTLE_CYCLES (32UL * 32 * CLOCK_FLL_REFDIV)
+
+volatile unsigned char clock_on_crystals = 0;
+volatile unsigned int clock_ready_ticks = 0;
+volatile unsigned int clock_crystal_ticks = 0;
+
+void pmmVCore (unsigned int level);
+void clockInit();
+void clockInitBlocking();
+void clockTrySwitchToCrystals();
+void clockFllRetune(unsigned int fll_n);
+void clockWaitCrystals();
+void clockBootTimerStart();
+unsigned int clockBootTicks();
+
+// CÓDIGO NÃO MODIFICADO =============================================================
+void pmmVCore (unsigned int level)
+{
+#if defined (__MSP430F5529__)
+    PMMCTL0_H = 0xA5;                       // Open PMM registers for write access
+
+    SVSMHCTL =                              // Set SVS/SVM high side new level
+            SVSHE            +
+            SVSHRVL0 * level +
+            SVMHE            +
+            SVSMHRRL0 * level;
+
+    SVSMLCTL =                              // Set SVM low side to new level
+            SVSLE            +
+//          SVSLRVL0 * level +              // but not SVS, not yet..
+            SVMLE            +
+            SVSMLRRL0 * level;
+
+    while ((PMMIFG & SVSMLDLYIFG) == 0);    // Wait till SVM is settled
+
+    PMMIFG &= ~(SVMLVLRIFG + SVMLIFG);      // Clear already set flags
+
+    PMMCTL0_L = PMMCOREV0 * level;          // Set VCore to new level
+
+    if ((PMMIFG & SVMLIFG))                 // Wait till new level reached
+        while ((PMMIFG & SVMLVLRIFG) == 0);
+
+    SVSMLCTL =                              // Set SVS/SVM low side to new level
+            SVSLE            +
+            SVSLRVL0 * level +
+            SVMLE            +
+            SVSMLRRL0 * level;
+
+    PMMCTL0_H = 0x00;                       // Lock PMM registers for write access
+#endif
+}
+
+// Medida da partida ==================================================================
+void clockBootTimerStart()
+{
+    RTCCTL01 = RTCHOLD | RTCSSEL_0 | RTCTEV_3;  // Contador de 32 bits em ACLK, parado
+    RTCNT12 = 0;
+    RTCNT34 = 0;
+    RTCCTL01 &= ~RTCHOLD;
+}
+
+/*
+ * O contador anda com o ACLK, fora do MCLK: lê até duas leituras seguidas baterem.
+ */
+unsigned int clockBootTicks()
+{
+    unsigned int ticks;
+    do {
+        ticks = RTCNT12;
+    } while (ticks != RTCNT12);
+    return ticks;
+}
+
+// Partida ============================================================================
+/*
+ * Partida rápida: não espera os cristais.
+ * MCLK = DCO ~ 8 MHz e SMCLK = DCOCLKDIV ~ 4 MHz com o FLL referenciado no REFO, ACLK = REFO.
+ * Isso vale em VCore 0 e deixa os periféricos com os mesmos clocks nominais desde o início.
+ * XT1/XT2 partem em paralelo; a falha de oscilador (UNMI) arma o TB0, que confere se eles
+ * estabilizaram, e só então o VCore sobe e os clocks vão para a configuração final:
+ * ACLK = XT1 (32768 Hz), SMCLK = XT2 (4 MHz), MCLK = DCO (25 MHz).
+ * Antes o reset só chegava no main depois dos 3 níveis de VCore e da partida do XT1
+ * (centenas de ms); agora chega depois de algumas escritas em registradores.
+ *
+ * A troca acontece numa interrupção do TB0 depois daqui (com o GIE ligado). Código que
+ * depende do clock final (medidas de tempo) chama clockWaitCrystals antes.
+ */
+void clockInit()
+{
+    clockBootTimerStart();
+
+    P5SEL |= BIT2 | BIT3 | BIT4 | BIT5;
+    UCSCTL6 = XT2DRIVE_2 | XT1DRIVE_2 | XCAP_3; // Liga XT1 e XT2, sem esperar
+
+    UCSCTL0 = 0x00;
+    UCSCTL1 = DCORSEL_5;
+    UCSCTL2 = FLLD__2 | FLLN(122);          // DCO = 2 * 122 * 32768 ~ 7,99 MHz
+    UCSCTL3 = SELREF__REFOCLK | FLLREFDIV__1;
+
+    UCSCTL5 = DIVPA_1 | DIVA_0 | DIVM_0;
+
+    UCSCTL4 = SELA__REFOCLK   |             // ACLK  = REFO      =>      32.768 Hz
+              SELS__DCOCLKDIV |             // SMCLK = DCO / 2   => ~ 3.998.000 Hz
+              SELM__DCOCLK;                 // MCLK  = DCO       => ~ 7.995.000 Hz
+
+    // Timer de nova tentativa, usado enquanto os cristais não estabilizam
+    TB0CTL = TBSSEL__ACLK | MC_0 | TBCLR;
+    TB0CCR0 = CLOCK_RETRY_TICKS;
+
+    clock_ready_ticks = clockBootTicks();
+
+    // A falha de oscilador já está pendente: o UNMI arma a primeira tentativa no TB0
+    SFRIE1 |= OFIE;
+}
+
+/*
+ * Chamada pelo TB0. Se algum oscilador ainda falha, tenta de novo em ~1 ms.
+ */
+void clockTrySwitchToCrystals()
+{
+    UCSCTL7 &= ~(XT2OFFG | XT1LFOFFG | DCOFFG);
+    SFRIFG1 &= ~OFIFG;
+
+    if (SFRIFG1 & OFIFG) {
+        return;
+    }
+
+    TB0CTL = MC_0 | TBCLR;
+    TB0CCTL0 = 0;
+    SFRIE1 &= ~OFIE;
+
+    // VCore sobe antes da frequência
+    pmmVCore(1);
+    pmmVCore(2);
+    pmmVCore(3);
+
+    UCSCTL4 = SELA__XT1CLK    |             // ACLK  = XT1   =>      32.768 Hz
+              SELS__XT2CLK    |             // SMCLK = XT2   =>   4.000.000 Hz
+              SELM__XT2CLK;                 // MCLK  = XT2 enquanto o FLL muda
+    UCSCTL3 = SELREF__XT2CLK | FLLREFDIV__4;
+    clockFllRetune(25);                     // MCLK  = DCO   =>  25.000.000 Hz
+
+    clock_crystal_ticks = clockBootTicks();
+    RTCCTL01 |= RTCHOLD;
+    clock_on_crystals = 1;
+#ifdef CLOCK_ON_CRYSTALS_HOOK
+    CLOCK_ON_CRYSTALS_HOOK();
+#endif
+}
+
+/*
+ * Troca o FLLN com o MCLK no XT2 e só volta o MCLK para o DCO depois do FLL assentar.
+ * O DCOFFG não diz que o FLL travou (só que o DCO bateu no fim da faixa), então primeiro
+ * espera o pior caso (CLOCK_FLL_SETTLE_CYCLES) e depois confere que o DCOFFG não volta.
+ * Chamar com a referência do FLL já no XT2 / 4.
+ */
+void clockFllRetune(unsigned int fll_n)
+{
+    UCSCTL4 = (UCSCTL4 & ~SELM_7) | SELM__XT2CLK;
+    UCSCTL2 = FLLD__1 | FLLN(fll_n);
+
+    __delay_cycles(CLOCK_FLL_SETTLE_CYCLES);
+    do {
+        UCSCTL7 &= ~DCOFFG;
+        SFRIFG1 &= ~OFIFG;
+    } while (UCSCTL7 & DCOFFG);
+
+    UCSCTL4 = (UCSCTL4 & ~SELM_7) | SELM__DCOCLK;
+}
+
+/*
+ * Dorme em LPM0 até a troca para os cristais (a interrupção do TB0 acorda).
+ * Depois dela o OFIE fica desligado e não há mais UNMI de oscilador.
+ */
+void clockWaitCrystals()
+{
+    unsigned short interrupt_state = __get_interrupt_state();
+    __disable_interrupt();
+    while (!clock_on_crystals) {
+        __bis_SR_register(LPM0_bits | GIE);
+        __disable_interrupt();
+    }
+    __set_interrupt_state(interrupt_state);
+}
+
+#pragma vector = UNMI_VECTOR
+__interrupt void __unmi_interrupt_handle(void)
+{
+    switch (__even_in_range(SYSUNIV, 0x08))
+    {
+    case SYSUNIV_OFIFG:
+        // Só agenda: a troca roda no TB0, que o GIE mascara
+        SFRIE1 &= ~OFIE;
+        TB0CCTL0 = CCIE;
+        TB0CTL = TBSSEL__ACLK | MC_1 | TBCLR;
+        break;
+    default:
+        break;
+    }
+}
+
+#pragma vector = TIMER0_B0_VECTOR
+__interrupt void __tb0_clock_retry_handle(void)
+{
+    clockTrySwitchToCrystals();
+    if (clock_on_crystals) {
+        __bic_SR_register_on_exit(LPM0_bits);
+    }
+}
+
+// Partida original: espera os 3 níveis de VCore e todos os cristais (para comparação)
+void clockInitBlocking()
+{
+    clockBootTimerStart();
+
+    pmmVCore(1);
+    pmmVCore(2);
+    pmmVCore(3);
+
+    P5SEL |= BIT2 | BIT3 | BIT4 | BIT5;
+    UCSCTL0 = 0x00;
+    UCSCTL1 = DCORSEL_5;
+    UCSCTL2 = FLLD__1 | FLLN(25);
+    UCSCTL3 = SELREF__XT2CLK | FLLREFDIV__4;
+    UCSCTL6 = XT2DRIVE_2 | XT1DRIVE_2 | XCAP_3;
+    UCSCTL7 = 0;                            // Clear XT2,XT1,DCO fault flags
+
+    do {                                    // Check if all clocks are oscillating
+      UCSCTL7 &= ~(   XT2OFFG |             // Try to clear XT2,XT1,DCO fault flags,
+                    XT1LFOFFG |             // system fault flags and check if
+                       DCOFFG );            // oscillators are still faulty
+      SFRIFG1 &= ~OFIFG;                    //
+    } while (SFRIFG1 & OFIFG);              // Exit only when everything is ok
+
+    UCSCTL5 = DIVPA_1 | DIVA_0 | DIVM_0; //Divide ACLK por 2.
+
+    UCSCTL4 = SELA__XT1CLK    |             // ACLK  = XT1   =>      16.384 Hz
+              SELS__XT2CLK    |             // SMCLK = XT2   =>   4.000.000 Hz
+              SELM__DCOCLK;                 // MCLK  = DCO   =>  25.000.000 Hz
+
+    clock_ready_ticks = clockBootTicks();
+    clock_crystal_ticks = clock_ready_ticks;
+    RTCCTL01 |= RTCHOLD;
+    clock_on_crystals = 1;
+#ifdef CLOCK_ON_CRYSTALS_HOOK
+    CLOCK_ON_CRYSTALS_HOOK();
+#endif
+}
+
+#endif /* CLOCK_INIT_H_ */
@@ -0,0 +1,85 @@
+/*
+ * clocks.h
+ *
+ * Cálculo em tempo de compilação dos divisores dos periféricos a partir da árvore de clocks.
+ * Antes de incluir, o experimento define a frequência de cada clock que usa, por exemplo:
+ *
+ *   #define ACLK_HZ   32768UL
+ *   #define SMCLK_HZ  4000000UL
+ *   #define MCLK_HZ   25000000UL
+ *
+ * Todas as macros só usam constantes, então o compilador reduz cada uma a um literal.
+ * As macros *_ACHIEVED_* dão a frequência obtida e CLOCK_ERROR_PERMILLE o erro em
+ * relação ao alvo, para conferir no debugger ou com CLOCK_STATIC_ASSERT.
+ *
+ * Obs.: no clockInit dos experimentos, ACLK = XT1 / 1 = 32768 Hz (DIVA_0).
+ * O DIVPA_1 só divide a saída de ACLK no pino, não o ACLK dos periféricos.
+ */
+
+#ifndef CLOCKS_H_
+#define CLOCKS_H_
+
+#define CLOCK_DIV_ROUND(a, b) (((a) + (b) / 2) / (b))
+#define CLOCK_DIV_CEIL(a, b)  (((a) + (b) - 1) / (b))
+
+// Erro em décimos de por cento (ex.: 6 => +0,6%)
+#define CLOCK_ERROR_PERMILLE(achieved, target) \
+    ((long) ((((long long) (achieved)) - ((long long) (target))) * 1000 / ((long long) (target))))
+
+// Falha a compilação se a condição for falsa
+#define CLOCK_STATIC_ASSERT(condition, name) typedef char name[(condition)? 1 : -1]
+
+// UART (USCI_A) ======================================================================
+// clk / baud >= 16: UCOS16, UCBRx = INT(N / 16), UCBRFx = ROUND(FRAC(N / 16) * 16)
+// clk / baud < 16:  UCBRx = INT(N), UCBRSx = ROUND(FRAC(N) * 8)
+#define UART_OS16(clk, baud) ((clk) / (baud) >= 16)
+#define UART_BR_RAW(clk, baud) \
+    (UART_OS16(clk, baud)? (clk) / (16UL * (baud)) : (clk) / (baud))
+#define UART_FRAC_RAW(clk, baud) \
+    (UART_OS16(clk, baud)? CLOCK_DIV_ROUND(clk, baud) - 16UL * UART_BR_RAW(clk, baud) \
+                         : CLOCK_DIV_ROUND(8UL * (clk), baud) - 8UL * UART_BR_RAW(clk, baud))
+// Se a fração arredondar para 1, vai para UCBRx
+#define UART_FRAC_CARRY(clk, baud) \
+    (UART_FRAC_RAW(clk, baud) == (UART_OS16(clk, baud)? 16UL : 8UL))
+
+#define UART_BR(clk, baud) (UART_BR_RAW(clk, baud) + (UART_FRAC_CARRY(clk, baud)? 1 : 0))
+#define UART_FRAC(clk, baud) (UART_FRAC_CARRY(clk, baud)? 0 : UART_FRAC_RAW(clk, baud))
+#define UART_BR0(clk, baud) (UART_BR(clk, baud) & 0xFF)
+#define UART_BR1(clk, baud) (UART_BR(clk, baud) >> 8)
+#define UART_MCTL(clk, baud) \
+    (UART_OS16(clk, baud)? ((UART_FRAC(clk, baud) << 4) | UCOS16) : (UART_FRAC(clk, baud) << 1))
+#define UART_ACHIEVED_BAUD(clk, baud) \
+    (UART_OS16(clk, baud)? (clk) / (16UL * UART_BR(clk, baud) + UART_FRAC(clk, baud)) \
+                         : (8UL * (clk)) / (8UL * UART_BR(clk, baud) + UART_FRAC(clk, baud)))
+
+// Ciclos de um timer (clk / div) para transmitir um caractere de bits_per_char bits
+#define UART_CHAR_TIMER_TICKS(clk, div, baud, bits_per_char) \
+    CLOCK_DIV_CEIL((bits_per_char) * ((clk) / (div)), baud)
+
+// I2C (USCI_B mestre) ================================================================
+// SCL = clk / UCBRx, arredondado para cima para nunca passar do alvo. O mestre precisa de UCBRx >= 4.
+#define I2C_BR(clk, scl) CLOCK_DIV_CEIL(clk, scl)
+#define I2C_BR0(clk, scl) (I2C_BR(clk, scl) & 0xFF)
+#define I2C_BR1(clk, scl) (I2C_BR(clk, scl) >> 8)
+#define I2C_ACHIEVED_SCL(clk, scl) ((clk) / I2C_BR(clk, scl))
+
+// SPI (USCI_A/B mestre) ==============================================================
+// SPI clock = clk / UCBRx (UCBRx = 0 também divide por 1)
+#define SPI_BR(clk, hz) CLOCK_DIV_CEIL(clk, hz)
+#define SPI_BR0(clk, hz) (SPI_BR(clk, hz) & 0xFF)
+#define SPI_BR1(clk, hz) (SPI_BR(clk, hz) >> 8)
+#define SPI_ACHIEVED_HZ(clk, hz) ((clk) / SPI_BR(clk, hz))
+
+// Timers =============================================================================
+// Modo up: o contador vai de 0 a CCR0, então o período tem CCR0 + 1 ciclos de clk / div
+#define TIMER_CCR0(clk, div, hz) (CLOCK_DIV_ROUND((clk) / (div), hz) - 1)
+#define TIMER_ACHIEVED_HZ(clk, div, hz) ((clk) / (div) / (TIMER_CCR0(clk, div, hz) + 1))
+
+// Divisor de entrada (ID) que deixa o timer o mais perto possível de 1 tick por us
+#define TIMER_US_DIVIDER(clk) \
+    ((clk) >= 8000000UL? 8 : (clk) >= 4000000UL? 4 : (clk) >= 2000000UL? 2 : 1)
+#define TIMER_US_ID(clk) \
+    (TIMER_US_DIVIDER(clk) == 8? ID__8 : TIMER_US_DIVIDER(clk) == 4? ID__4 : \
+     TIMER_US_DIVIDER(clk) == 2? ID__2 : ID__1)
+
+#endif /* CLOCKS_H_ */
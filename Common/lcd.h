@@ -0,0 +1,653 @@
+/*
+ * lcd.h
+ *
+ * Driver do LCD HD44780 atrás de um PCF8574 (I2C no UCB0), compartilhado pelos experimentos.
+ * A geometria, o endereço e o mapeamento dos pinos são parâmetros de compilação, então
+ * os deslocamentos das linhas e os limites viram constantes e o buffer tem o tamanho exato.
+ *
+ * Antes de incluir, o experimento precisa ter:
+ *  - msp430.h e clocks.h (ACLK_HZ, SMCLK_HZ) e LCD_I2C_SCL_HZ;
+ *  - os tipos bool/byte (e true/false) e o protótipo de delay_us;
+ *  - o UCB0 configurado como master antes de initialize_lcd.
+ *
+ * Parâmetros (todos opcionais, padrão entre parênteses):
+ *   LCD_ROWS (2), LCD_COLS (16)            16x2, 20x4, 40x2, ...
+ *   LCD_I2C_ADDRESS (0x27)
+ *   LCD_RS_BIT (BIT0), LCD_RW_BIT (BIT1), LCD_ENABLE_BIT (BIT2), LCD_BACKLIGHT_BIT (BIT3)
+ *   LCD_DATA_SHIFT (4)                     D4..D7 em P4..P7 do PCF8574
+ *   LCD_USE_BUSY_FLAG (1), LCD_QUEUE_SIZE (64), LCD_STATS (1)
+ *   LCD_WAIT_TIMER_* (TB0)                 Timer das esperas longas (ACLK, modo up, CCR0)
+ *
+ * O driver usa as interrupções do UCB0 e do timer de espera; o experimento não pode usá-las.
+ */
+
+#ifndef LCD_H_
+#define LCD_H_
+
+// Parâmetros =========================================================================
+#ifndef LCD_ROWS
+#define LCD_ROWS 2
+#endif
+#ifndef LCD_COLS
+#define LCD_COLS 16
+#endif
+#ifndef LCD_I2C_ADDRESS
+#define LCD_I2C_ADDRESS 0x27
+#endif
+
+#ifndef LCD_RS_BIT
+#define LCD_RS_BIT BIT0
+#endif
+#ifndef LCD_RW_BIT
+#define LCD_RW_BIT BIT1
+#endif
+#ifndef LCD_ENABLE_BIT
+#define LCD_ENABLE_BIT BIT2
+#endif
+#ifndef LCD_BACKLIGHT_BIT
+#define LCD_BACKLIGHT_BIT BIT3
+#endif
+#ifndef LCD_DATA_SHIFT
+#define LCD_DATA_SHIFT 4
+#endif
+
+// Clear/home: 1 lê o busy flag pelo PCF8574 em vez de esperar o pior caso; 0 usa só o timer.
+// Os outros comandos não leem BF: uma leitura custa ~9 bytes no barramento, mais que os 37 us.
+#ifndef LCD_USE_BUSY_FLAG
+#define LCD_USE_BUSY_FLAG 1
+#endif
+#define LCD_BUSY_MAX_POLLS 8    // ~1 ms por leitura a 100 kHz; depois disso cai no timer
+
+// Contadores do barramento (lcd_stats) para comparar otimizações do driver no próprio alvo
+#ifndef LCD_STATS
+#define LCD_STATS 1
+#endif
+
+#ifndef LCD_QUEUE_SIZE
+#define LCD_QUEUE_SIZE 64       // Potência de 2; cabe clear + redesenho completo de 16x2
+#endif
+
+#ifndef LCD_WAIT_TIMER_CTL
+#define LCD_WAIT_TIMER_CTL TB0CTL
+#define LCD_WAIT_TIMER_CCR0 TB0CCR0
+#define LCD_WAIT_TIMER_CCTL0 TB0CCTL0
+#define LCD_WAIT_TIMER_START (TBSSEL__ACLK | MC_1 | TBCLR)
+#define LCD_WAIT_TIMER_STOP (MC_0 | TBCLR)
+#define LCD_WAIT_TIMER_VECTOR TIMER0_B0_VECTOR
+#endif
+
+// HD44780: 80 bytes de DDRAM; linhas 1/3 começam em 0x40 e 2/3 continuam as linhas 0/1
+CLOCK_STATIC_ASSERT(LCD_ROWS >= 1 && LCD_ROWS <= 4 && LCD_ROWS * LCD_COLS <= 80, lcd_geometry_invalid);
+CLOCK_STATIC_ASSERT((LCD_QUEUE_SIZE & (LCD_QUEUE_SIZE - 1)) == 0, lcd_queue_size_not_power_of_2);
+#define LCD_ROW_ADDRESS(row) ((((row) & 1)? 0x40 : 0x00) + (((row) & 2)? LCD_COLS : 0))
+
+#define LCD_DATA_MASK (0x0F << LCD_DATA_SHIFT)
+#define LCD_BUSY_BIT (BIT3 << LCD_DATA_SHIFT)   // D7
+#define LCD_DIRTY_WORDS ((LCD_COLS + 15) / 16)
+#define LCD_DIRTY_BIT(col) (1u << ((col) & 15))
+
+#define LCD_SET_DDRAM_ADDRESS_BIT BIT7
+#define LCD_DDRAM_LINE_LENGTH 40    // Em modo 2 linhas; o display shift gira dentro dela
+#define LCD_EMPTY_CHAR (0x20)
+#define LCD_CURSOR_UNKNOWN (0xFF)
+
+// Tempos do HD44780 (datasheet, fosc = 270 kHz)
+#define LCD_DELAY_POWER_ON_US 50000     // Vcc > 4.5 V até aceitar comandos
+#define LCD_DELAY_INIT_FIRST_US 4100    // Depois do primeiro 0x3
+#define LCD_DELAY_INIT_SECOND_US 100    // Depois do segundo 0x3
+#define LCD_DELAY_CLEAR_HOME_US 1600    // Clear (0x01) e return home (0x02)
+#define LCD_DELAY_COMMAND_US 37         // Todos os outros comandos e escrita de dados
+#define LCD_DELAY_CLEAR_HOME_TICKS CLOCK_DIV_CEIL(LCD_DELAY_CLEAR_HOME_US * ACLK_HZ, 1000000UL)
+// Entre a descida do E de um byte e a do próximo há pelo menos 3 bytes no barramento
+CLOCK_STATIC_ASSERT(3UL * 9 * 1000000 / I2C_ACHIEVED_SCL(SMCLK_HZ, LCD_I2C_SCL_HZ) >= LCD_DELAY_COMMAND_US,
+                    lcd_i2c_faster_than_hd44780);
+
+// Tipos ==============================================================================
+typedef struct {
+    bool backlight_on;
+    byte address;
+    char buffer[LCD_ROWS][LCD_COLS];
+    char shadow[LCD_ROWS][LCD_COLS];            // O que está no painel
+    uint16_t dirty[LCD_ROWS][LCD_DIRTY_WORDS];  // Células a reenviar mesmo sem mudança (1 bit por coluna)
+    byte cursor_row;        // Posição do cursor do HD44780, LCD_CURSOR_UNKNOWN se não se sabe
+    byte cursor_col;
+} LCD;
+
+// Fila de bytes do LCD, drenada em segundo plano pela interrupção do UCB0 e pelo timer de espera.
+// Os nibbles já vão montados (RS, backlight); a ISR só gera os strobes de E.
+typedef struct {
+    byte address;
+    byte high;
+    byte low;
+    byte flags;
+} LcdOp;
+
+#define LCD_OP_LONG_WAIT BIT0   // Clear/home: STOP e espera LCD_DELAY_CLEAR_HOME_US antes do próximo
+#define LCD_QUEUE_MASK (LCD_QUEUE_SIZE - 1)
+
+LcdOp lcd_queue[LCD_QUEUE_SIZE];
+volatile unsigned int lcd_queue_head = 0;   // Escrito por lcd_queue_push
+volatile unsigned int lcd_queue_tail = 0;   // Escrito pela ISR
+volatile byte lcd_strobe_step = 0;          // Próximo byte do op atual (0..5)
+volatile byte lcd_bus_address = 0;          // Endereço da transação aberta
+volatile bool lcd_bus_active = false;       // Transação aberta ou espera em andamento
+volatile bool lcd_frame_done = true;        // Fila vazia e última espera cumprida
+volatile unsigned int lcd_nacks = 0;
+volatile unsigned int lcd_bus_switches = 0;    // Repeated STARTs para outro display
+volatile bool lcd_busy_flag = false;        // D7 da última leitura
+volatile byte lcd_busy_reads = 0;           // Bytes recebidos na leitura atual
+volatile byte lcd_busy_polls = 0;           // Leituras feitas para o op atual
+
+// O que o driver colocou no barramento desde o último lcd_stats_reset. Para medir uma operação
+// (lcd_flush, initialize_lcd, um print...): reset, operação, lcd_wait_idle, ler no debugger.
+// Tests/lcd_test.c confere os contadores contra um modelo do barramento (make -C Tests).
+typedef struct {
+    unsigned long transactions;     // STARTs, incluindo repeated START
+    unsigned long bytes;            // Bytes de dados escritos e lidos (sem o endereço)
+    unsigned long ops;              // Bytes do HD44780 enfileirados (comandos + caracteres)
+    unsigned long delay_us;         // Esperas síncronas (delay_us)
+    unsigned long wait_ticks;       // Esperas por timer, em ticks de ACLK
+} LcdStats;
+
+volatile LcdStats lcd_stats;
+
+#if LCD_STATS
+#define LCD_STATS_ADD(field, n) (lcd_stats.field += (n))
+#else
+#define LCD_STATS_ADD(field, n) ((void) 0)
+#endif
+
+void lcd_stats_reset();
+void lcd_delay_us(unsigned int time_us);
+
+bool master_TransmitBytes(unsigned char address, const byte* data, unsigned int length);
+
+void lcd_queue_push(LCD* lcd, byte b, bool is_instruction);
+void lcd_bus_start();
+void lcd_bus_wait(unsigned int aclk_ticks);
+void lcd_wait_timer_arm(unsigned int aclk_ticks);
+void lcd_wait_idle();
+
+// Low level LCD
+LCD initialize_lcd(byte address);
+byte assemble_byte_from_lcd_nibble(LCD* lcd, byte nibble, bool is_instruction);
+void lcd_send_raw_byte(LCD* lcd, byte b);
+void lcd_send_nibble(LCD* lcd, byte nibble, bool is_instruction);
+void lcd_send_byte(LCD* lcd, byte b, bool is_instruction);
+
+// High level LCD
+void lcd_set_cursor_position(LCD* lcd, byte row, byte col);
+void lcd_write_char(LCD* lcd, byte c);
+void lcd_clear(LCD* lcd);
+void lcd_return_home(LCD* lcd);
+void lcd_shift_display(LCD* lcd, bool left);
+void lcd_define_glyph(LCD* lcd, byte slot, const byte* rows);
+
+// LCD Buffer
+void lcd_flush(LCD* lcd);
+void lcd_invalidate(LCD* lcd);
+
+// Implementação ======================================================================
+void lcd_stats_reset()
+{
+    unsigned short interrupt_state = __get_interrupt_state();
+    __disable_interrupt();
+    lcd_stats.transactions = 0;
+    lcd_stats.bytes = 0;
+    lcd_stats.ops = 0;
+    lcd_stats.delay_us = 0;
+    lcd_stats.wait_ticks = 0;
+    __set_interrupt_state(interrupt_state);
+}
+
+void lcd_delay_us(unsigned int time_us)
+{
+    LCD_STATS_ADD(delay_us, time_us);
+    delay_us(time_us);
+}
+
+LCD initialize_lcd(byte address)
+{
+    LCD lcd;
+    lcd.address = address;
+    lcd.backlight_on = true;
+    lcd.cursor_row = LCD_CURSOR_UNKNOWN;
+    lcd.cursor_col = LCD_CURSOR_UNKNOWN;
+
+    // Sequência de inicialização por instrução (datasheet, figura 24).
+    // Os nibbles iniciais são síncronos (esperas longas); o resto vai pela fila.
+    lcd_delay_us(LCD_DELAY_POWER_ON_US);
+    lcd_send_nibble(&lcd, 0x03, true);
+    lcd_delay_us(LCD_DELAY_INIT_FIRST_US);
+    lcd_send_nibble(&lcd, 0x03, true);
+    lcd_delay_us(LCD_DELAY_INIT_SECOND_US);
+    lcd_send_nibble(&lcd, 0x03, true);
+    lcd_send_nibble(&lcd, 0x02, true);
+
+    // Function set: 4 bits, 2 linhas de endereço (também para 4x20; 1x só para LCD_ROWS = 1)
+    lcd_send_byte(&lcd, LCD_ROWS > 1? 0x28 : 0x20, true);
+    lcd_send_byte(&lcd, 0x08, true);
+    lcd_clear(&lcd);
+    lcd_send_byte(&lcd, 0x06, true);
+    lcd_send_byte(&lcd, 0x0F, true);
+
+    return lcd;
+}
+
+byte assemble_byte_from_lcd_nibble(LCD* lcd, byte nibble, bool is_instruction)
+{
+    byte result = is_instruction? 0x00 : LCD_RS_BIT;
+    result |= (nibble & 0xf) << LCD_DATA_SHIFT;
+    result |= lcd->backlight_on? LCD_BACKLIGHT_BIT : 0;
+    return result;
+}
+
+void lcd_send_nibble(LCD* lcd, byte nibble, bool is_instruction)
+{
+    lcd_send_raw_byte(lcd, assemble_byte_from_lcd_nibble(lcd, nibble, is_instruction));
+}
+
+/*
+ * Não bloqueia: o byte entra na fila e vai para o barramento em segundo plano.
+ */
+void lcd_send_byte(LCD* lcd, byte b, bool is_instruction)
+{
+    lcd_queue_push(lcd, b, is_instruction);
+}
+
+void lcd_send_raw_byte(LCD* lcd, byte b)
+{
+    byte strobes[3] = { b, b | LCD_ENABLE_BIT, b };
+    master_TransmitBytes(lcd->address, strobes, sizeof(strobes));
+}
+
+void lcd_set_cursor_position(LCD* lcd, byte row, byte col)
+{
+    lcd_send_byte(lcd, (LCD_ROW_ADDRESS(row) + col) | LCD_SET_DDRAM_ADDRESS_BIT, true);
+    lcd->cursor_row = row;
+    lcd->cursor_col = col;
+}
+
+void lcd_write_char(LCD* lcd, byte c)
+{
+    lcd_send_byte(lcd, c, false);
+    // O HD44780 incrementa o endereço sozinho (entry mode 0x06)
+    lcd->cursor_col++;
+}
+
+void lcd_clear(LCD* lcd)
+{
+    byte i, j;
+    for (i = 0; i < LCD_ROWS; i++) {
+        for (j = 0; j < LCD_COLS; j++) {
+            lcd->buffer[i][j] = LCD_EMPTY_CHAR;
+            lcd->shadow[i][j] = LCD_EMPTY_CHAR;
+        }
+        for (j = 0; j < LCD_DIRTY_WORDS; j++) {
+            lcd->dirty[i][j] = 0;
+        }
+    }
+
+    lcd_send_byte(lcd, 0x1, true);
+    // Clear volta o cursor para (0, 0)
+    lcd->cursor_row = 0;
+    lcd->cursor_col = 0;
+}
+
+/*
+ * Desfaz o display shift e volta o cursor para (0, 0), sem apagar a DDRAM.
+ */
+void lcd_return_home(LCD* lcd)
+{
+    lcd_send_byte(lcd, 0x02, true);
+    lcd->cursor_row = 0;
+    lcd->cursor_col = 0;
+}
+
+/*
+ * Desloca a janela visível uma coluna (as duas linhas juntas). Não muda o endereço do cursor,
+ * mas o buffer/shadow deixam de corresponder ao que aparece: não misturar com lcd_flush.
+ */
+void lcd_shift_display(LCD* lcd, bool left)
+{
+    lcd_send_byte(lcd, left? 0x18 : 0x1C, true);
+}
+
+/*
+ * Grava um caractere 5x8 na CGRAM (slot 0..7, usado como código 0..7 no buffer).
+ * rows: 8 linhas, 5 bits cada (bit 4 = coluna da esquerda). O contador de endereço fica na
+ * CGRAM, então o próximo caractere precisa de um set cursor.
+ */
+void lcd_define_glyph(LCD* lcd, byte slot, const byte* rows)
+{
+    byte i;
+    lcd_send_byte(lcd, 0x40 | ((slot & 0x7) << 3), true);
+    for (i = 0; i < 8; i++) {
+        lcd_send_byte(lcd, rows[i] & 0x1F, false);
+    }
+    lcd->cursor_row = LCD_CURSOR_UNKNOWN;
+    lcd->cursor_col = LCD_CURSOR_UNKNOWN;
+}
+
+/*
+ * Força o próximo lcd_flush a reenviar todas as células.
+ */
+void lcd_invalidate(LCD* lcd)
+{
+    byte i, j;
+    for (i = 0; i < LCD_ROWS; i++) {
+        for (j = 0; j < LCD_DIRTY_WORDS; j++) {
+            lcd->dirty[i][j] = 0xFFFF;
+        }
+    }
+}
+
+/*
+ * Envia só as células que mudaram desde o último flush (buffer != shadow ou marcadas em dirty).
+ * O cursor só é reposicionado quando a próxima célula suja não é a seguinte à última escrita;
+ * um buraco de uma célula limpa é reescrito, que custa menos que mover o cursor.
+ */
+void lcd_flush(LCD* lcd)
+{
+    byte i, j;
+    for (i = 0; i < LCD_ROWS; i++) {
+        for (j = 0; j < LCD_COLS; j++) {
+            if (lcd->buffer[i][j] != lcd->shadow[i][j]) {
+                lcd->dirty[i][j >> 4] |= LCD_DIRTY_BIT(j);
+            }
+        }
+
+        for (j = 0; j < LCD_COLS; j++) {
+            if (!(lcd->dirty[i][j >> 4] & LCD_DIRTY_BIT(j))) {
+                continue;
+            }
+
+            if (lcd->cursor_row != i || lcd->cursor_col != j) {
+                if (lcd->cursor_row == i && lcd->cursor_col + 1 == j) {
+                    lcd_write_char(lcd, lcd->shadow[i][j - 1]);
+                } else {
+                    lcd_set_cursor_position(lcd, i, j);
+                }
+            }
+
+            lcd_write_char(lcd, lcd->buffer[i][j]);
+            lcd->shadow[i][j] = lcd->buffer[i][j];
+            lcd->dirty[i][j >> 4] &= ~LCD_DIRTY_BIT(j);
+        }
+    }
+}
+
+/*
+ * Escreve length bytes numa única transação (START, endereço, dados, STOP), em polling.
+ * Antes espera a fila esvaziar: o barramento e as interrupções do UCB0 são da ISR enquanto
+ * ela drena. Espera o STOP terminar para que a próxima chamada encontre o barramento livre.
+ * Retorna false se o escravo não respondeu.
+ */
+bool master_TransmitBytes(unsigned char address, const byte* data, unsigned int length)
+{
+    unsigned int i;
+
+    lcd_wait_idle();
+    UCB0IE = 0;
+    UCB0I2CSA = address;
+
+    while (UCB0CTL1 & UCTXSTP);
+    UCB0IFG &= ~UCNACKIFG;
+    UCB0CTL1 |= UCTR | UCTXSTT;
+    LCD_STATS_ADD(transactions, 1);
+
+    for (i = 0; i <= length; i++) {
+        //TXIFG: o byte anterior (ou o START) já foi para o shift register
+        while ((UCB0IFG & UCTXIFG) == 0) {
+            if (UCB0IFG & UCNACKIFG) {
+                UCB0CTL1 |= UCTXSTP;
+                UCB0IFG &= ~UCNACKIFG;
+                while (UCB0CTL1 & UCTXSTP);
+                return false;
+            }
+        }
+
+        if (i < length) {
+            UCB0TXBUF = data[i];
+            LCD_STATS_ADD(bytes, 1);
+        }
+    }
+
+    UCB0CTL1 |= UCTXSTP;
+    while (UCB0CTL1 & UCTXSTP);
+
+    return true;
+}
+
+/*
+ * Enfileira um byte para o LCD. Se a fila estiver cheia, dorme (LPM0) até a ISR liberar espaço.
+ */
+void lcd_queue_push(LCD* lcd, byte b, bool is_instruction)
+{
+    LcdOp* op;
+    unsigned short interrupt_state = __get_interrupt_state();
+
+    __disable_interrupt();
+    while (((lcd_queue_head + 1) & LCD_QUEUE_MASK) == lcd_queue_tail) {
+        __bis_SR_register(LPM0_bits | GIE);
+        __disable_interrupt();
+    }
+
+    op = &lcd_queue[lcd_queue_head];
+    op->address = lcd->address;
+    op->high = assemble_byte_from_lcd_nibble(lcd, (b >> 4) & 0xf, is_instruction);
+    op->low = assemble_byte_from_lcd_nibble(lcd, b & 0xf, is_instruction);
+    op->flags = (is_instruction && b < 0x04)? LCD_OP_LONG_WAIT : 0;
+    lcd_queue_head = (lcd_queue_head + 1) & LCD_QUEUE_MASK;
+    LCD_STATS_ADD(ops, 1);
+    lcd_frame_done = false;
+
+    if (!lcd_bus_active) {
+        lcd_bus_start();
+    }
+    __set_interrupt_state(interrupt_state);
+}
+
+/*
+ * Abre uma transação para o op da cauda, ou marca o frame como pronto se a fila esvaziou.
+ * Continua do lcd_strobe_step atual (retomada depois da leitura do busy flag).
+ * Chamada com interrupções desligadas ou de dentro de uma ISR: não espera o STOP anterior;
+ * se ele ainda está saindo, tenta de novo no próximo tick do timer de espera.
+ */
+void lcd_bus_start()
+{
+    if (lcd_queue_tail == lcd_queue_head) {
+        lcd_bus_active = false;
+        lcd_frame_done = true;
+        return;
+    }
+
+    lcd_bus_active = true;
+    if (UCB0CTL1 & UCTXSTP) {
+        UCB0IE = 0;
+        lcd_wait_timer_arm(1);
+        return;
+    }
+
+    lcd_bus_address = lcd_queue[lcd_queue_tail].address;
+    UCB0I2CSA = lcd_bus_address;
+    UCB0IFG &= ~(UCTXIFG | UCNACKIFG);
+    UCB0IE = UCTXIE | UCNACKIE;
+    UCB0CTL1 |= UCTR | UCTXSTT;
+    LCD_STATS_ADD(transactions, 1);
+}
+
+/*
+ * Fecha a transação e agenda lcd_bus_start para daqui a aclk_ticks.
+ */
+void lcd_bus_wait(unsigned int aclk_ticks)
+{
+    UCB0CTL1 |= UCTXSTP;
+    UCB0IE = 0;
+    lcd_wait_timer_arm(aclk_ticks);
+}
+
+void lcd_wait_timer_arm(unsigned int aclk_ticks)
+{
+    LCD_WAIT_TIMER_CCR0 = aclk_ticks;
+    LCD_STATS_ADD(wait_ticks, aclk_ticks);
+    LCD_WAIT_TIMER_CCTL0 = CCIE;
+    LCD_WAIT_TIMER_CTL = LCD_WAIT_TIMER_START;
+}
+
+/*
+ * Dorme em LPM0 (SMCLK continua para o I2C) até a fila esvaziar.
+ */
+void lcd_wait_idle()
+{
+    unsigned short interrupt_state = __get_interrupt_state();
+    __disable_interrupt();
+    while (!lcd_frame_done) {
+        __bis_SR_register(LPM0_bits | GIE);
+        __disable_interrupt();
+    }
+    __set_interrupt_state(interrupt_state);
+}
+
+/*
+ * Uma transação carrega vários ops seguidos: [h, h|E, h, l, l|E, l] por op.
+ * Só fecha quando a fila esvazia ou depois de clear/home. Vários displays (um LCD por endereço)
+ * dividem a mesma fila: quando o endereço muda, um repeated START troca de display sem STOP,
+ * então a banda total é a do barramento, qualquer que seja o número de displays.
+ *
+ * Com LCD_USE_BUSY_FLAG, clear/home seguem com a leitura do BF (passos 6..12):
+ *  6, 7   [r, r|E] com r = D7..D4 em 1 (entrada no PCF8574) e RW = 1
+ *  8      repeated START como receptor, 2 bytes; D7 do primeiro é o BF
+ *  9..11  nova escrita [r, r|E, r]: baixa E e pulsa o segundo nibble (descartado)
+ *  12     BF = 1 volta ao passo 6, BF = 0 segue para o próximo op
+ */
+#pragma vector = USCI_B0_VECTOR
+__interrupt void __ucb0_lcd_interrupt(void)
+{
+    LcdOp* op;
+    byte nibble;
+
+    switch (__even_in_range(UCB0IV, 12)) {
+        case 4: // NACK: descarta os ops seguidos desse endereço (display ausente) e tenta o resto
+            lcd_nacks++;
+            UCB0IFG &= ~UCNACKIFG;
+            lcd_strobe_step = 0;
+            lcd_busy_polls = 0;
+            do {
+                lcd_queue_tail = (lcd_queue_tail + 1) & LCD_QUEUE_MASK;
+            } while (lcd_queue_tail != lcd_queue_head && lcd_queue[lcd_queue_tail].address == lcd_bus_address);
+            lcd_bus_wait(1);
+            __bic_SR_register_on_exit(LPM0_bits);
+            break;
+        case 10: // RXIFG: leitura do busy flag
+            LCD_STATS_ADD(bytes, 1);
+            if (lcd_busy_reads++ == 0) {
+                lcd_busy_flag = (UCB0RXBUF & LCD_BUSY_BIT) != 0;
+                UCB0CTL1 |= UCTXSTP;    // O segundo byte é o último
+            } else {
+                nibble = UCB0RXBUF;
+                lcd_bus_start();
+            }
+            break;
+        case 12: // TXIFG
+            // A leitura do UCB0IV já limpou o TXIFG: toda passagem que não fecha a transação
+            // precisa escrever no TXBUF (ou pedir um START), senão a fila para. Quando um op
+            // termina, o laço já manda o primeiro byte do próximo.
+            while (1) {
+                if (lcd_queue_tail == lcd_queue_head) {
+                    UCB0CTL1 |= UCTXSTP;
+                    UCB0IE = 0;
+                    lcd_bus_active = false;
+                    lcd_frame_done = true;
+                    __bic_SR_register_on_exit(LPM0_bits);
+                    break;
+                }
+
+                op = &lcd_queue[lcd_queue_tail];
+                if (lcd_strobe_step == 0 && op->address != lcd_bus_address) {
+                    // O último byte do display anterior termina e o USCI gera o repeated START;
+                    // TXIFG volta quando o novo endereço foi enviado
+                    lcd_bus_address = op->address;
+                    lcd_bus_switches++;
+                    UCB0I2CSA = lcd_bus_address;
+                    UCB0IFG &= ~UCTXIFG;
+                    UCB0CTL1 |= UCTR | UCTXSTT;
+                    LCD_STATS_ADD(transactions, 1);
+                    break;
+                }
+
+                if (lcd_strobe_step < 6) {
+                    nibble = lcd_strobe_step < 3? op->high : op->low;
+                    UCB0TXBUF = (lcd_strobe_step % 3 == 1)? (nibble | LCD_ENABLE_BIT) : nibble;
+                    LCD_STATS_ADD(bytes, 1);
+                    lcd_strobe_step++;
+                    break;
+                }
+
+#if LCD_USE_BUSY_FLAG
+                if (op->flags & LCD_OP_LONG_WAIT) {
+                    nibble = (op->high & LCD_BACKLIGHT_BIT) | LCD_DATA_MASK | LCD_RW_BIT;
+
+                    if (lcd_strobe_step == 6 || lcd_strobe_step == 9 || lcd_strobe_step == 11) {
+                        UCB0TXBUF = nibble;
+                        LCD_STATS_ADD(bytes, 1);
+                        lcd_strobe_step++;
+                        break;
+                    }
+                    if (lcd_strobe_step == 7 || lcd_strobe_step == 10) {
+                        UCB0TXBUF = nibble | LCD_ENABLE_BIT;
+                        LCD_STATS_ADD(bytes, 1);
+                        lcd_strobe_step++;
+                        break;
+                    }
+                    if (lcd_strobe_step == 8) {
+                        lcd_busy_reads = 0;
+                        lcd_strobe_step = 9;
+                        UCB0IE = UCRXIE | UCNACKIE;
+                        UCB0CTL1 &= ~UCTR;
+                        UCB0CTL1 |= UCTXSTT;
+                        LCD_STATS_ADD(transactions, 1);
+                        break;
+                    }
+                    if (lcd_busy_flag && lcd_busy_polls < LCD_BUSY_MAX_POLLS) {
+                        // Nova leitura: o passo 6 já escreve o primeiro byte nesta passagem
+                        lcd_busy_polls++;
+                        lcd_strobe_step = 6;
+                        continue;
+                    }
+                }
+#endif
+
+                // Último strobe já está no shift register; o próximo op vai nesta mesma passagem
+                lcd_strobe_step = 0;
+                lcd_queue_tail = (lcd_queue_tail + 1) & LCD_QUEUE_MASK;
+                __bic_SR_register_on_exit(LPM0_bits);   // Espaço na fila
+#if LCD_USE_BUSY_FLAG
+                lcd_busy_polls = 0;
+                if ((op->flags & LCD_OP_LONG_WAIT) && lcd_busy_flag) {   // BF não baixou: espera o pior caso
+#else
+                if (op->flags & LCD_OP_LONG_WAIT) {
+#endif
+                    lcd_bus_wait(LCD_DELAY_CLEAR_HOME_TICKS);
+                    break;
+                }
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+#pragma vector = LCD_WAIT_TIMER_VECTOR
+__interrupt void __lcd_wait_timer_handle(void)
+{
+    LCD_WAIT_TIMER_CTL = LCD_WAIT_TIMER_STOP;
+    LCD_WAIT_TIMER_CCTL0 = 0;
+
+    lcd_bus_start();
+    if (lcd_frame_done) {
+        __bic_SR_register_on_exit(LPM0_bits);
+    }
+}
+
+#endif /* LCD_H_ */
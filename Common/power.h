@@ -0,0 +1,193 @@
+/*
+ * power.h
+ *
+ * Pontos de operação (DVFS) sobre a árvore de clock_init.h, com contagem do tempo
+ * passado em cada ponto.
+ *
+ * SMCLK (XT2) e ACLK (XT1) não mudam entre os pontos, então os divisores dos periféricos
+ * calculados em clocks.h continuam válidos; só MCLK e o VCore mudam. Subindo, o VCore sobe
+ * antes da frequência; descendo, depois.
+ *
+ * Até a troca para os cristais o ponto é POWER_BOOT (DCO/REFO, VCore 0): power_set não faz
+ * nada e o tempo não entra em power_ticks. A contagem começa quando clockTrySwitchToCrystals
+ * termina (o clock final é o POWER_HIGH).
+ *
+ * Antes de incluir: msp430.h e clocks.h (ACLK_HZ). Este header inclui clock_init.h, para
+ * ligar a contagem na troca de clocks; não incluir clock_init.h antes dele.
+ *
+ * Parâmetros (opcional, padrão entre parênteses):
+ *   POWER_TIMER_* (TA2)     Contador livre em ACLK da contagem de tempo (estouro com TAIE)
+ */
+
+#ifndef POWER_H_
+#define POWER_H_
+
+#ifdef CLOCK_INIT_H_
+#error "power.h tem que ser incluído antes de clock_init.h"
+#endif
+
+#ifndef POWER_TIMER_CTL
+#define POWER_TIMER_CTL TA2CTL
+#define POWER_TIMER_R TA2R
+#define POWER_TIMER_IV TA2IV
+#define POWER_TIMER_IV_TAIFG TA2IV_TAIFG
+#define POWER_TIMER_VECTOR TIMER2_A1_VECTOR
+#endif
+
+typedef enum {
+    POWER_LOW,  // MCLK = XT2   =>  4 MHz, VCore 0
+    POWER_MID,  // MCLK = DCO   => 12 MHz, VCore 1
+    POWER_HIGH, // MCLK = DCO   => 25 MHz, VCore 3
+    POWER_OP_COUNT,
+    POWER_BOOT = POWER_OP_COUNT // Antes dos cristais; fora da contagem
+} PowerOperatingPoint;
+
+typedef struct {
+    unsigned char vcore;
+    unsigned char fll_n;    // DCO = FLLN * (XT2 / 4); 0 = MCLK direto do XT2
+    unsigned long mclk_hz;
+} PowerOperatingPointConfig;
+
+void pmmVCoreDown(unsigned int level);
+void power_init();
+void power_start();
+void power_account();
+void power_set(PowerOperatingPoint op);
+unsigned long long power_mclk_cycles(PowerOperatingPoint op);
+
+#define CLOCK_ON_CRYSTALS_HOOK() power_start()
+#include "clock_init.h"
+
+// Estado ==============================================================================
+const PowerOperatingPointConfig power_operating_points[POWER_OP_COUNT] = {
+    { 0,  0,  4000000UL },
+    { 1, 12, 12000000UL },
+    { 3, 25, 25000000UL },
+};
+
+volatile PowerOperatingPoint power_current = POWER_BOOT;
+volatile unsigned long power_ticks[POWER_OP_COUNT];   // Ciclos de ACLK em cada ponto
+volatile unsigned int power_last_tick = 0;
+
+// Implementação ======================================================================
+/*
+ * Baixa o VCore um nível. A frequência já tem que ser compatível com o novo nível.
+ */
+void pmmVCoreDown(unsigned int level)
+{
+    PMMCTL0_H = 0xA5;                       // Open PMM registers for write access
+
+    PMMIFG &= ~(SVMLVLRIFG + SVMLIFG + SVSMLDLYIFG);
+
+    SVSMLCTL =                              // Set SVS/SVM low side to new level
+            SVSLE            +
+            SVSLRVL0 * level +
+            SVMLE            +
+            SVSMLRRL0 * level;
+
+    while ((PMMIFG & SVSMLDLYIFG) == 0);    // Wait till SVM is settled
+
+    PMMCTL0_L = PMMCOREV0 * level;          // Set VCore to new level
+
+    PMMCTL0_H = 0x00;                       // Lock PMM registers for write access
+}
+
+void power_init()
+{
+    volatile int i;
+    unsigned short interrupt_state = __get_interrupt_state();
+    __disable_interrupt();
+
+    for (i = 0; i < POWER_OP_COUNT; i++) {
+        power_ticks[i] = 0;
+    }
+
+    // Contador livre em ACLK; o estouro só serve para não perder tempo na conta
+    POWER_TIMER_CTL = TASSEL__ACLK | MC__CONTINUOUS | TACLR | TAIE;
+    power_last_tick = 0;
+
+    __set_interrupt_state(interrupt_state);
+}
+
+/*
+ * Chamada pela troca para os cristais (dentro do TB0, ou no clockInitBlocking):
+ * o clock final é o POWER_HIGH e a contagem começa agora.
+ */
+void power_start()
+{
+    power_last_tick = POWER_TIMER_R;
+    power_current = POWER_HIGH;
+}
+
+void power_account()
+{
+    unsigned int now = POWER_TIMER_R;
+    if (power_current != POWER_BOOT) {
+        power_ticks[power_current] += (unsigned int) (now - power_last_tick);
+    }
+    power_last_tick = now;
+}
+
+void power_set(PowerOperatingPoint op)
+{
+    if (power_current == POWER_BOOT || op >= POWER_OP_COUNT || op == power_current) return;
+
+    const PowerOperatingPointConfig* config = &power_operating_points[op];
+    unsigned short interrupt_state = __get_interrupt_state();
+    __disable_interrupt();
+
+    power_account();
+
+    unsigned int level = PMMCTL0_L & PMMCOREV_3;
+
+    // Subindo: VCore primeiro
+    while (level < config->vcore) {
+        pmmVCore(++level);
+    }
+
+    // MCLK no XT2 enquanto o FLL muda e assenta, para nunca passar do limite do VCore
+    if (config->fll_n) {
+        clockFllRetune(config->fll_n);
+    } else {
+        UCSCTL4 = (UCSCTL4 & ~SELM_7) | SELM__XT2CLK;
+    }
+
+    // Descendo: VCore depois
+    while (level > config->vcore) {
+        pmmVCoreDown(--level);
+    }
+
+    power_current = op;
+    __set_interrupt_state(interrupt_state);
+}
+
+/*
+ * Ciclos de MCLK passados no ponto op: ticks * mclk / ACLK em 64 bits, sem truncar a razão
+ * (25 MHz / 32768 = 762,9). power_ticks (32 bits) cobre ~36 h por ponto; o resultado
+ * cabe em 64 bits nesse intervalo todo.
+ */
+unsigned long long power_mclk_cycles(PowerOperatingPoint op)
+{
+    unsigned short interrupt_state = __get_interrupt_state();
+    __disable_interrupt();
+    unsigned long ticks = power_ticks[op];
+    __set_interrupt_state(interrupt_state);
+
+    return (unsigned long long) ticks * power_operating_points[op].mclk_hz / ACLK_HZ;
+}
+
+// Interrupção =========================================================================
+#pragma vector = POWER_TIMER_VECTOR
+__interrupt void __power_timer_overflow_handle(void)
+{
+    switch (__even_in_range(POWER_TIMER_IV, 14))
+    {
+    case POWER_TIMER_IV_TAIFG:
+        power_account();
+        break;
+    default:
+        break;
+    }
+}
+
+#endif /* POWER_H_ */
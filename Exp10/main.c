@@ -1,8 +1,13 @@
 #include <msp430.h>
 #include <inttypes.h>
 
-#define to_high_nibble(b) ((b & 0xf) << 4)
-#define to_low_nibble(b) ((b & 0xf))
+// Árvore de clocks padrão após o reset (sem clockInit)
+#define ACLK_HZ 32768UL
+#define SMCLK_HZ 1048576UL
+#include "../Common/clocks.h"
+
+#define LCD_I2C_SCL_HZ 100000UL // Máximo do PCF8574
+CLOCK_STATIC_ASSERT(I2C_BR(SMCLK_HZ, LCD_I2C_SCL_HZ) >= 4, lcd_i2c_scl_too_fast);
 
 typedef uint8_t bool;
 const bool true = 1;
@@ -10,33 +15,11 @@ const bool false = 0;
 
 typedef uint8_t byte;
 
-typedef struct {
-    bool backlight_on;
-    byte address;
-    char buffer[2][16];
-} LCD;
-
-
-#define LCD_ADDRESS 0x27
-#define LCD_ENABLE_BIT BIT2
-#define LCD_BACKLIGHT_BIT BIT3
-#define LCD_SET_DDRAM_ADDRESS_BIT BIT7
-
-// Low level LCD
-LCD initialize_lcd(byte address);
-byte assemble_byte_from_lcd_nibble(LCD* lcd, byte nibble, bool is_instruction);
-void lcd_send_raw_byte(LCD* lcd, byte b);
-void lcd_send_nibble(LCD* lcd, byte nibble, bool is_instruction);
-void lcd_send_byte(LCD* lcd, byte b, bool is_instruction);
-
-// High level LCD
-void lcd_set_cursor_position(LCD* lcd, byte row, byte col);
-void lcd_write_char(LCD* lcd, byte c);
-void lcd_clear(LCD* lcd);
+void delay_us(unsigned int time_us);
 
-// LCD Buffer
-#define LCD_EMPTY_CHAR (0x20)
-void lcd_flush(LCD* lcd);
+// LCD 16x2 no PCF8574 (Common/lcd.h). O driver usa o UCB0 e o TB0
+#include "../Common/lcd.h"
+#include "../Common/adc_snapshot.h"
 
 #define LED_RED_ON      (P1OUT |= BIT0)
 #define LED_RED_OFF     (P1OUT &= ~BIT0)
@@ -46,10 +29,67 @@ void lcd_flush(LCD* lcd);
 
 void initialize_I2C_UCB0_MasterTransmitter();
 void master_TransmitOneByte(unsigned char address, unsigned char data);
-void delay_us(unsigned int time_us);
 
-volatile unsigned int measurements[4];
-volatile bool measurements_ready = 0;
+// Aquisição x exibição =====================================================
+// O ADC roda a ADC_SEQUENCE_HZ e toda sequência entra nos filtros: pela ISR, uma a uma,
+// ou pelo DMA, um bloco por vez (ADC_USE_DMA). O display é redesenhado a RENDER_FPS com
+// o último valor filtrado; se o frame anterior ainda está no barramento, o frame é pulado,
+// nunca acumulado.
+#define ADC_SEQUENCE_HZ 64
+// Sem ADC12SHP/ADC12MSC, cada borda do TA0.1 dispara uma só conversão: a sequência
+// de 16 conversões precisa de 16 bordas
+#define ADC_CONVERSIONS_PER_SEQUENCE 16
+#define ADC_TRIGGER_HZ (ADC_SEQUENCE_HZ * ADC_CONVERSIONS_PER_SEQUENCE)
+#ifndef RENDER_FPS
+#define RENDER_FPS 8
+#endif
+#define RENDER_SAMPLES_PER_FRAME (ADC_SEQUENCE_HZ / RENDER_FPS)
+CLOCK_STATIC_ASSERT(RENDER_SAMPLES_PER_FRAME >= 1, render_fps_above_adc_rate);
+
+// Média exponencial por canal: y += (x - y) / 2^FILTER_SHIFT (0 desliga o filtro), com
+// constante de tempo de ~2^FILTER_SHIFT sequências. Com DMA o filtro roda uma vez por bloco
+// (ACQUISITION_FILTER_SHIFT, abaixo)
+#ifndef FILTER_SHIFT
+#define FILTER_SHIFT 3
+#endif
+CLOCK_STATIC_ASSERT(FILTER_SHIFT <= 4, filter_state_overflows_16_bits); // 4095 << 4 cabe em 16 bits
+
+AdcSnapshot adc_snapshot;                // Saída dos filtros, publicada por acquisition_push
+unsigned int measurements[4];            // Cópia do laço principal, uma por frame
+volatile unsigned int filter_state[4];   // Acumuladores (valor << ACQUISITION_FILTER_SHIFT)
+volatile bool render_due = 0;
+volatile unsigned int render_countdown = RENDER_SAMPLES_PER_FRAME;
+
+// Contadores para o debugger
+volatile unsigned long adc_samples = 0;          // Sequências de 16 conversões filtradas
+volatile unsigned int adc_samples_dropped = 0;   // ADC12OV: conversão sobrescrita antes da leitura
+volatile unsigned int render_frames = 0;         // Frames enviados ao LCD
+volatile unsigned int render_frames_skipped = 0; // Frames pulados com o LCD ainda ocupado
+
+// acquisition_push roda na ISR do ADC sem DMA e só no laço principal com DMA (o ADC12IE15
+// fica desligado e a ISR nem tem a chamada): no build padrão (ADC_USE_DMA = 1) o snapshot
+// é escrito e lido no mesmo contexto e adc_snapshot_read nunca repete a cópia.
+bool acquisition_push(unsigned int* sample, unsigned int sequences);
+
+// DMA (Common/adc_dma.h): o DMA guarda ADC_DMA_BLOCK_SEQUENCES sequências e a média é feita
+// no laço principal, então a CPU acorda 64 / 8 = 8 vezes por segundo em vez de 64. Com blocos
+// maiores que RENDER_SAMPLES_PER_FRAME, os frames ficam limitados a um por bloco.
+// Profundidade por canal: ADC_DMA_OVERSAMPLING.
+#ifndef ADC_USE_DMA
+#define ADC_USE_DMA 1
+#endif
+#if ADC_USE_DMA
+#include "../Common/adc_dma.h"
+#define ACQUISITION_PENDING() adc_dma_block_ready()
+// Cada amostra do filtro já é a média de um bloco de 2^ADC_DMA_BLOCK_SHIFT sequências, e chega
+// 2^ADC_DMA_BLOCK_SHIFT vezes menos: o shift desconta o bloco para a constante de tempo
+// continuar ~2^FILTER_SHIFT sequências (com 3 e 3, o bloco sozinho já faz a média)
+#define ACQUISITION_FILTER_SHIFT \
+    (FILTER_SHIFT > ADC_DMA_BLOCK_SHIFT? FILTER_SHIFT - ADC_DMA_BLOCK_SHIFT : 0)
+#else
+#define ACQUISITION_PENDING() false
+#define ACQUISITION_FILTER_SHIFT FILTER_SHIFT
+#endif
 
 void configure_leds();
 void configure_buttons();
@@ -58,11 +98,72 @@ void configure_adc();
 
 void millivolts_to_volt_string(int millivolts, char* result);
 void to_hex_string(int value, char* result);
-void printVoltage(char* name, unsigned int measurement, LCD* lcd);
-void printLuminosity(char* name, unsigned int measurement, LCD* lcd);
-void print_bars(unsigned int measurement, LCD* lcd);
 void copy_str(char* origin, char* dest, int length);
-void update_output(int mode, LCD* lcd);
+
+// Telas =====================================================================
+// Cada modo é um template fixo em flash (o texto constante: "=", "V", " 0x"...)
+// mais uma lista de campos variáveis. A cada amostra só os campos cujo valor mudou
+// são formatados no buffer, e o lcd_flush só envia as células diferentes do painel.
+typedef enum {
+    FIELD_LABEL,    // Nome do canal (só muda na troca de modo)
+    FIELD_VOLTAGE,  // "x,xxx" em volts
+    FIELD_HEX,      // Valor bruto em hexadecimal
+    FIELD_STATE,    // escuro / iluminado / lusco-fusco
+    FIELD_BARS,     // Barra proporcional à medida
+    FIELD_COUNT
+} FieldId;
+
+typedef struct {
+    byte id;
+    byte row;
+    byte col;
+    byte width;
+} ScreenField;
+
+#define SCREEN_MAX_FIELDS 4
+#define FIELD_STALE 0xFFFF // Valor impossível: força a formatação do campo
+
+typedef struct {
+    const char* text[LCD_ROWS];  // LCD_COLS caracteres por linha
+    const char* label;
+    byte channel;                // Índice em measurements[]
+    byte field_count;
+    ScreenField fields[SCREEN_MAX_FIELDS];
+} ScreenLayout;
+
+typedef struct {
+    const ScreenLayout* layout;
+    unsigned int values[FIELD_COUNT];  // Último valor formatado de cada campo
+} Screen;
+
+#define VOLTAGE_SCREEN(name, channel) \
+    { { "  =     V 0x    ", "                " }, name, channel, 4, \
+      { { FIELD_LABEL, 0, 0, 2 }, { FIELD_VOLTAGE, 0, 3, 5 }, { FIELD_HEX, 0, 12, 4 }, { FIELD_BARS, 1, 0, 16 } } }
+
+#define LUMINOSITY_SCREEN(name, channel) \
+    { { "  :             ", "                " }, name, channel, 3, \
+      { { FIELD_LABEL, 0, 0, 2 }, { FIELD_STATE, 0, 3, 12 }, { FIELD_BARS, 1, 0, 16 } } }
+
+#define SCREEN_MODES 6
+const ScreenLayout screen_layouts[SCREEN_MODES] = {
+    VOLTAGE_SCREEN("A1", 0),
+    VOLTAGE_SCREEN("A2", 1),
+    VOLTAGE_SCREEN("A3", 2),
+    VOLTAGE_SCREEN("A4", 3),
+    LUMINOSITY_SCREEN("A3", 2),
+    LUMINOSITY_SCREEN("A4", 3),
+};
+
+#define LUMINOSITY_DARK   0
+#define LUMINOSITY_BRIGHT 1
+#define LUMINOSITY_DUSK   2
+const char luminosity_text[3][13] = { "escuro      ", "iluminado   ", "lusco-fusco " };
+const byte luminosity_pwm[3] = { 1, 19, 10 }; // TA2CCR2 com TA2CCR0 = 20
+
+void screen_set_layout(Screen* screen, const ScreenLayout* layout, LCD* lcd);
+void screen_update(Screen* screen, LCD* lcd);
+unsigned int field_value(byte id, unsigned int measurement);
+void field_format(const ScreenField* field, unsigned int value, const ScreenLayout* layout, LCD* lcd);
 
 volatile int debouncing = 0;
 
@@ -72,32 +173,64 @@ int main(void)
 
     configure_leds();
     configure_adc_trigger_clk();
+#if ADC_USE_DMA
+    adc_dma_start();
+#endif
     configure_adc();
 
     initialize_I2C_UCB0_MasterTransmitter();
-    LCD lcd = initialize_lcd(LCD_ADDRESS);
+    LCD lcd = initialize_lcd(LCD_I2C_ADDRESS);
 
     __enable_interrupt();
 
+    Screen screen;
+    screen_set_layout(&screen, &screen_layouts[0], &lcd);
+
     volatile int mode = 0;
     while (true) {
-        debouncing -= debouncing > 0? 1 : 0;
+        // Dorme até o próximo frame ou até o DMA fechar um bloco
+        __disable_interrupt();
+        while (!render_due && !ACQUISITION_PENDING()) {
+            __bis_SR_register(LPM0_bits | GIE);
+            __disable_interrupt();
+        }
+        __enable_interrupt();
+
+#if ADC_USE_DMA
+        // Média do bloco aqui, fora da interrupção: uma vez a cada ADC_DMA_BLOCK_SEQUENCES sequências
+        if (adc_dma_block_ready()) {
+            unsigned int sample[4];
+            adc_dma_average(sample);
+            acquisition_push(sample, ADC_DMA_BLOCK_SEQUENCES);
+        }
+        if (!render_due) {
+            continue;
+        }
+#endif
+        render_due = 0;
 
+        // O botão é lido uma vez por frame: o debounce conta frames
+        debouncing -= debouncing > 0? 1 : 0;
         if (!(P6IN & BIT5) && debouncing <= 0) {
-            mode = (mode + 1) % 6;
+            mode = (mode + 1) % SCREEN_MODES;
             debouncing = 2;
-            lcd_clear(&lcd);
-            update_output(mode, &lcd);
+            // Sem lcd_clear: o template novo vai para o buffer e o próximo flush
+            // só reescreve as células que diferem da tela anterior.
+            screen_set_layout(&screen, &screen_layouts[mode], &lcd);
         }
 
-        // Esperear até as medidas serem feitas
-        if (!measurements_ready) {
+        // O frame anterior ainda está no barramento: pula este, o próximo já sai
+        // com o valor filtrado mais novo
+        if (!lcd_frame_done) {
+            render_frames_skipped++;
             continue;
         }
 
-        measurements_ready = 0;
-
-        update_output(mode, &lcd);
+        // Todos os canais do frame vêm da mesma sequência do ADC
+        adc_snapshot_read(&adc_snapshot, measurements);
+        screen_update(&screen, &lcd);
+        lcd_flush(&lcd);
+        render_frames++;
 
         MAIN_LED_TOGGLE;
     }
@@ -105,49 +238,97 @@ int main(void)
     return 0;
 }
 
-void update_output(int mode, LCD* lcd)
+/*
+ * Troca de tela: copia o template para o buffer e marca todos os campos como
+ * desatualizados. Nada é enviado aqui; o lcd_flush seguinte manda só a diferença.
+ */
+void screen_set_layout(Screen* screen, const ScreenLayout* layout, LCD* lcd)
 {
-    switch(mode + 1) {
-    case 1:
-        printVoltage("A1", measurements[0], lcd);
-        print_bars(measurements[0], lcd);
-        break;
-    case 2:
-        printVoltage("A2", measurements[1], lcd);
-        print_bars(measurements[1], lcd);
-        break;
-    case 3:
-        printVoltage("A3", measurements[2], lcd);
-        print_bars(measurements[2], lcd);
-        break;
-    case 4:
-        printVoltage("A4", measurements[3], lcd);
-        print_bars(measurements[3], lcd);
-        break;
-    case 5:
-        printLuminosity("A3", measurements[2], lcd);
-        print_bars(measurements[2], lcd);
-        break;
-    case 6:
-        printLuminosity("A4", measurements[3], lcd);
-        print_bars(measurements[3], lcd);
-        break;
+    volatile int i, j;
+    for (i = 0; i < LCD_ROWS; i++) {
+        for (j = 0; j < LCD_COLS; j++) {
+            lcd->buffer[i][j] = layout->text[i][j];
+        }
     }
 
+    for (i = 0; i < FIELD_COUNT; i++) {
+        screen->values[i] = FIELD_STALE;
+    }
+    screen->layout = layout;
+}
 
-    lcd_flush(lcd);
+/*
+ * Formata só os campos cujo valor mudou desde a última chamada.
+ */
+void screen_update(Screen* screen, LCD* lcd)
+{
+    const ScreenLayout* layout = screen->layout;
+    unsigned int measurement = measurements[layout->channel];
+
+    volatile int i;
+    for (i = 0; i < layout->field_count; i++) {
+        const ScreenField* field = &layout->fields[i];
+        unsigned int value = field_value(field->id, measurement);
+        if (value == screen->values[field->id]) {
+            continue;
+        }
+        field_format(field, value, layout, lcd);
+        screen->values[field->id] = value;
+    }
 }
 
-void print_bars(unsigned int measurement, LCD* lcd) {
-    // Measurement / 256 barras
-    volatile int bars = measurement >> 8;
-    volatile int i = 0;
-    for (i = 0; i < 16; i++) {
-        if (i < bars) {
-            lcd -> buffer[1][i] = '\xff';
-        } else {
-            lcd -> buffer[1][i] = ' ';
+unsigned int field_value(byte id, unsigned int measurement)
+{
+    switch (id) {
+    case FIELD_VOLTAGE:
+        // Arredondamento: 1000 * 3,3 / 4096 = 0,805 ~ (4 / 5)
+        return (measurement << 2) / 5;
+    case FIELD_HEX:
+        return measurement;
+    case FIELD_STATE: {
+        unsigned int remaining = 4096 - measurement;
+        if ((measurement >> 1) >= remaining) return LUMINOSITY_DARK;
+        if ((remaining >> 1) >= measurement) return LUMINOSITY_BRIGHT;
+        return LUMINOSITY_DUSK;
+    }
+    case FIELD_BARS:
+        // Measurement / 256 barras
+        return measurement >> 8;
+    default:
+        // FIELD_LABEL é constante na tela
+        return 0;
+    }
+}
+
+void field_format(const ScreenField* field, unsigned int value, const ScreenLayout* layout, LCD* lcd)
+{
+    char* dest = &lcd->buffer[field->row][field->col];
+    volatile int i;
+
+    switch (field->id) {
+    case FIELD_LABEL:
+        for (i = 0; i < field->width && layout->label[i] != '\0'; i++) {
+            dest[i] = layout->label[i];
         }
+        break;
+    case FIELD_VOLTAGE:
+        millivolts_to_volt_string(value, dest);
+        break;
+    case FIELD_HEX:
+        to_hex_string(value, dest);
+        break;
+    case FIELD_STATE:
+        for (i = 0; i < field->width; i++) {
+            dest[i] = luminosity_text[value][i];
+        }
+        TA2CCR0 = 20;
+        TA2CCR2 = luminosity_pwm[value];
+        break;
+    case FIELD_BARS:
+        for (i = 0; i < field->width; i++) {
+            dest[i] = i < value ? '\xff' : ' ';
+        }
+        break;
     }
 }
 
@@ -183,7 +364,7 @@ void configure_adc_trigger_clk()
     TA0CTL = TASSEL__ACLK | MC_1;
     TA0CCTL1 = OUTMOD_6;
 
-    TA0CCR0 = 512; // ACLK / 64 ~ 64Hz
+    TA0CCR0 = TIMER_CCR0(ACLK_HZ, 1, ADC_TRIGGER_HZ); // ACLK / 32 = 1024Hz -> 64 sequências/s
     TA0CCR1 = TA0CCR0 >> 1; // 50% duty cycle
 }
 
@@ -217,6 +398,7 @@ void configure_adc()
 
     ADC12CTL0 = ADC12SHT0_2 | // 16 ciclos de clock para o sampling time
                 ADC12SHT1_2 | // 16 ciclos de clock para o sampling time
+                ADC12OVIE | // Interrupção de overflow: conta as amostras perdidas
                 ADC12ON; // Liga o ADC
 
     ADC12CTL1 = ADC12CSTARTADD_0 | // Start address 0
@@ -247,8 +429,13 @@ void configure_adc()
     ADC12MCTL14 = ADC12SREF_0 | ADC12INCH_4;
     ADC12MCTL15 = ADC12SREF_0 | ADC12INCH_4 | ADC12EOS;
 
+#if ADC_USE_DMA
+    // Quem lê as MEMx é o DMA, no fim de cada sequência
+    ADC12IE = 0;
+#else
     // Habilita interrupção na última conversão
     ADC12IE = ADC12IE15;
+#endif
 
     // Habilita o módulo ADC após configurações
     ADC12CTL0 |= ADC12ENC;
@@ -280,8 +467,8 @@ void initialize_I2C_UCB0_MasterTransmitter()
                 UCSWRST ;             //Mantém o módulo desligado
 
     //Divisor de clock para o BAUDRate
-    UCB0BR0 = 2;
-    UCB0BR1 = 0;
+    UCB0BR0 = I2C_BR0(SMCLK_HZ, LCD_I2C_SCL_HZ);
+    UCB0BR1 = I2C_BR1(SMCLK_HZ, LCD_I2C_SCL_HZ);
 
     //Liga o módulo.
     UCB0CTL1 &= ~UCSWRST;
@@ -289,89 +476,6 @@ void initialize_I2C_UCB0_MasterTransmitter()
     //Se eu quisesse ligar interrupções eu iria fazer isso aqui, depois de re-ligar o módulo..
 }
 
-LCD initialize_lcd(byte address)
-{
-    LCD lcd;
-    lcd.address = LCD_ADDRESS;
-    lcd.backlight_on = true;
-
-    lcd_send_nibble(&lcd, 0x03, true);
-    lcd_send_nibble(&lcd, 0x03, true);
-    lcd_send_nibble(&lcd, 0x03, true);
-    lcd_send_nibble(&lcd, 0x02, true);
-
-    lcd_send_byte(&lcd, 0x28, true);
-    lcd_send_byte(&lcd, 0x08, true);
-    lcd_clear(&lcd);
-    lcd_send_byte(&lcd, 0x06, true);
-    lcd_send_byte(&lcd, 0x0F, true);
-
-    return lcd;
-}
-
-byte assemble_byte_from_lcd_nibble(LCD* lcd, byte nibble, bool is_instruction)
-{
-    volatile byte result = is_instruction? 0x00 : 0x01;
-    result |= to_high_nibble(nibble);
-    result |= lcd->backlight_on? LCD_BACKLIGHT_BIT : 0;
-    return result;
-}
-
-void lcd_send_nibble(LCD* lcd, byte nibble, bool is_instruction)
-{
-    volatile byte byte_to_send = assemble_byte_from_lcd_nibble(lcd, nibble, is_instruction);
-    lcd_send_raw_byte(lcd, byte_to_send);
-}
-
-void lcd_send_byte(LCD* lcd, byte b, bool is_instruction)
-{
-    lcd_send_nibble(lcd, (b >> 4) & 0xf, is_instruction);
-    lcd_send_nibble(lcd, b & 0xf,      is_instruction);
-}
-
-void lcd_send_raw_byte(LCD* lcd, byte b)
-{
-    master_TransmitOneByte(lcd->address, b);
-    delay_us(1000);
-    master_TransmitOneByte(lcd->address, b | LCD_ENABLE_BIT);
-    delay_us(2000);
-    master_TransmitOneByte(lcd->address, b);
-    delay_us(1000);
-}
-
-void lcd_set_cursor_position(LCD* lcd, byte row, byte col)
-{
-    lcd_send_byte(lcd, (row * 0x40 + col) | LCD_SET_DDRAM_ADDRESS_BIT, true);
-}
-
-void lcd_write_char(LCD* lcd, byte c)
-{
-    lcd_send_byte(lcd, c, false);
-}
-
-void lcd_clear(LCD* lcd)
-{
-    volatile int i, j;
-    for (i = 0; i < 2; i++) {
-        for (j = 0; j < 16; j++) {
-            lcd->buffer[i][j] = LCD_EMPTY_CHAR;
-        }
-    }
-
-    lcd_send_byte(lcd, 0x1, true);
-}
-
-void lcd_flush(LCD* lcd)
-{
-    volatile int i, j;
-    for (i = 0; i < 2; i++) {
-        lcd_set_cursor_position(lcd, i, 0);
-        for (j = 0; j < 16; j++) {
-            lcd_write_char(lcd, lcd->buffer[i][j]);
-        }
-    }
-}
-
 void master_TransmitOneByte(unsigned char address, unsigned char data)
 {
     //Desligo todas as interrupções
@@ -458,104 +562,73 @@ void to_hex_string(int value, char* result)
     }
 }
 
-void printVoltage(char* name, unsigned int measurement, LCD* lcd)
-{
-    // Arredondamento: 1000 * 3,3 / 4096 = 0,805 ~ (4 / 5)
-    volatile int millivolts = (measurement << 2) / 5;
-    char voltage_str[5];
-    millivolts_to_volt_string(millivolts, voltage_str);
-    char hex_str[4];
-    to_hex_string(measurement, hex_str);
-
-    lcd->buffer[0][0] = name[0];
-    lcd->buffer[0][1] = name[1];
-    lcd->buffer[0][2] = '=';
-
-    lcd->buffer[0][3] = voltage_str[0];
-    lcd->buffer[0][4] = voltage_str[1];
-    lcd->buffer[0][5] = voltage_str[2];
-    lcd->buffer[0][6] = voltage_str[3];
-    lcd->buffer[0][7] = voltage_str[4];
-    lcd->buffer[0][8] = 'V';
-
-    lcd->buffer[0][9] = ' ';
-    lcd->buffer[0][10] = '0';
-    lcd->buffer[0][11] = 'x';
-    lcd->buffer[0][12] = hex_str[0];
-    lcd->buffer[0][13] = hex_str[1];
-    lcd->buffer[0][14] = hex_str[2];
-    lcd->buffer[0][15] = hex_str[3];
+void copy_str(char* origin, char* dest, int length) {
+    volatile int i = 0;
+    for (i = 0; i++; i < length) {
+        *(dest + i) = *(origin + i);
+    }
 }
 
-void printLuminosity(char* name, unsigned int measurement, LCD* lcd)
+/*
+ * Filtra uma amostra (uma sequência, ou a média de um bloco do DMA), publica para o
+ * laço principal e agenda os frames. Devolve true quando um frame deve ser desenhado.
+ */
+bool acquisition_push(unsigned int* sample, unsigned int sequences)
 {
-    lcd->buffer[0][0] = name[0];
-    lcd->buffer[0][1] = name[1];
-    lcd->buffer[0][2] = ':';
-
-    volatile unsigned int remaining = 4096 - measurement;
+    volatile int i;
 
-    if ((measurement >> 1) >= remaining) {
-        char text[12] = "escuro      ";
-        TA2CCR0 = 20;
-        TA2CCR2 = 1;
-        volatile int i = 0;
-        for (i = 0; i < 12 && text[i] != '\0'; i++) {
-            lcd->buffer[0][3+i] = text[i];
-        }
-        return;
-    }
-
-    if ((remaining >> 1) >= measurement) {
-        char text[12] = "iluminado   ";
-        TA2CCR0 = 20;
-        TA2CCR2 = 19;
-        volatile int i = 0;
-        for (i = 0; i < 12 && text[i] != '\0'; i++) {
-            lcd->buffer[0][3+i] = text[i];
+    // Filtros: a primeira amostra inicializa o acumulador (sem rampa a partir de 0)
+    for (i = 0; i < 4; i++) {
+        if (adc_samples == 0) {
+            filter_state[i] = sample[i] << ACQUISITION_FILTER_SHIFT;
+        } else {
+            filter_state[i] += sample[i] - (filter_state[i] >> ACQUISITION_FILTER_SHIFT);
         }
-        return;
+        sample[i] = filter_state[i] >> ACQUISITION_FILTER_SHIFT;
     }
+    adc_snapshot_publish(&adc_snapshot, sample);
+    adc_samples += sequences;
 
-    char text[12] = "lusco-fusco ";
-    TA2CCR0 = 20;
-    TA2CCR2 = 10;
-    volatile int i = 0;
-    for (i = 0; i < 12 && text[i] != '\0'; i++) {
-        lcd->buffer[0][3+i] = text[i];
-    }
-}
-
-void copy_str(char* origin, char* dest, int length) {
-    volatile int i = 0;
-    for (i = 0; i++; i < length) {
-        *(dest + i) = *(origin + i);
+    // Agenda um frame a cada RENDER_SAMPLES_PER_FRAME sequências (no máximo um por chamada)
+    if (render_countdown > sequences) {
+        render_countdown -= sequences;
+        return false;
     }
+    render_countdown = RENDER_SAMPLES_PER_FRAME;
+    render_due = true;
+    return true;
 }
 
 // INTERRRUPÇÕES =============================================
 #pragma vector = ADC12_VECTOR
 __interrupt void __adc12_interrupt(void)
 {
+#if !ADC_USE_DMA
+    unsigned int sample[4];
+#endif
+
     switch(__even_in_range(ADC12IV,0x24)) {
         case ADC12IV_NONE:
             break;
         case ADC12IV_ADC12OVIFG:    //MEMx overflow
+            adc_samples_dropped++;
             break;
         case ADC12IV_ADC12TOVIFG:  //Conversion Time overflow
             break;
         case ADC12IV_ADC12IFG15:
+#if !ADC_USE_DMA
             // ADC12MEM15 preenchida
 
             // Ler valores preenchidos
-            measurements[0] = (ADC12MEM0 + ADC12MEM1 + ADC12MEM2 + ADC12MEM3) >> 2;
-            measurements[1] = (ADC12MEM4 + ADC12MEM5 + ADC12MEM6 + ADC12MEM7) >> 2;
-            measurements[2] = (ADC12MEM8 + ADC12MEM9 + ADC12MEM10 + ADC12MEM11) >> 2;
-            measurements[3] = (ADC12MEM12 + ADC12MEM13 + ADC12MEM14 + ADC12MEM15) >> 2;
-
-            // Setar flag
-            measurements_ready = true;
-
+            sample[0] = (ADC12MEM0 + ADC12MEM1 + ADC12MEM2 + ADC12MEM3) >> 2;
+            sample[1] = (ADC12MEM4 + ADC12MEM5 + ADC12MEM6 + ADC12MEM7) >> 2;
+            sample[2] = (ADC12MEM8 + ADC12MEM9 + ADC12MEM10 + ADC12MEM11) >> 2;
+            sample[3] = (ADC12MEM12 + ADC12MEM13 + ADC12MEM14 + ADC12MEM15) >> 2;
+
+            if (acquisition_push(sample, 1)) {
+                __bic_SR_register_on_exit(LPM0_bits);
+            }
+#endif
             break;
         default:
             // Fazer nada
@@ -1,14 +1,19 @@
 #include <msp430.h>
 
+// Árvore de clocks configurada pelo clockInit
+#define ACLK_HZ 32768UL
+#define SMCLK_HZ 4000000UL
+#define MCLK_HZ 25000000UL
+#include "../Common/clocks.h"
+#include "../Common/clock_init.h"
+
+#define SPI_HZ 32768UL
+
 #define TOGGLE_RED_LED (P1OUT ^= BIT0)
 #define TOGGLE_GREEN_LED (P4OUT ^= BIT7)
 
 #define PASSWORD_LEN 5
 
-#define FLLN(x) ((x)-1)
-void clockInit();
-void pmmVCore (unsigned int level);
-
 void configSPIUCB1();
 void configSPIUCB0ForTest();
 void configButton();
@@ -78,8 +83,8 @@ void configSPIUCB1()
     // Configurar como master
     UCB1CTL1 |= UCSSEL__ACLK;
     UCB1CTL0 |= UCMST;
-    UCB1BR0 = 0;
-    UCB1BR1 = 0;
+    UCB1BR0 = SPI_BR0(ACLK_HZ, SPI_HZ);
+    UCB1BR1 = SPI_BR1(ACLK_HZ, SPI_HZ);
 
     // Pinos direcionados para o módulo
     P4SEL |= BIT1 | BIT2 | BIT3;
@@ -123,72 +128,6 @@ __interrupt void __p2_interrupt_handle(void)
     }
 }
 
-// FUNÇÕES INALTERADAS ===========================================================
-void pmmVCore (unsigned int level)
-{
-#if defined (__MSP430F5529__)
-    PMMCTL0_H = 0xA5;                       // Open PMM registers for write access
-
-    SVSMHCTL =                              // Set SVS/SVM high side new level
-            SVSHE            +
-            SVSHRVL0 * level +
-            SVMHE            +
-            SVSMHRRL0 * level;
-
-    SVSMLCTL =                              // Set SVM low side to new level
-            SVSLE            +
-//          SVSLRVL0 * level +              // but not SVS, not yet..
-            SVMLE            +
-            SVSMLRRL0 * level;
-
-    while ((PMMIFG & SVSMLDLYIFG) == 0);    // Wait till SVM is settled
-
-    PMMIFG &= ~(SVMLVLRIFG + SVMLIFG);      // Clear already set flags
-
-    PMMCTL0_L = PMMCOREV0 * level;          // Set VCore to new level
-
-    if ((PMMIFG & SVMLIFG))                 // Wait till new level reached
-        while ((PMMIFG & SVMLVLRIFG) == 0);
-
-    SVSMLCTL =                              // Set SVS/SVM low side to new level
-            SVSLE            +
-            SVSLRVL0 * level +
-            SVMLE            +
-            SVSMLRRL0 * level;
-
-    PMMCTL0_H = 0x00;                       // Lock PMM registers for write access
-#endif
-}
-
-void clockInit()
-{
-    pmmVCore(1);
-    pmmVCore(2);
-    pmmVCore(3);
-
-    P5SEL |= BIT2 | BIT3 | BIT4 | BIT5;
-    UCSCTL0 = 0x00;
-    UCSCTL1 = DCORSEL_5;
-    UCSCTL2 = FLLD__1 | FLLN(25);
-    UCSCTL3 = SELREF__XT2CLK | FLLREFDIV__4;
-    UCSCTL6 = XT2DRIVE_2 | XT1DRIVE_2 | XCAP_3;
-    UCSCTL7 = 0;                            // Clear XT2,XT1,DCO fault flags
-
-    do {                                    // Check if all clocks are oscillating
-      UCSCTL7 &= ~(   XT2OFFG |             // Try to clear XT2,XT1,DCO fault flags,
-                    XT1LFOFFG |             // system fault flags and check if
-                       DCOFFG );            // oscillators are still faulty
-      SFRIFG1 &= ~OFIFG;                    //
-    } while (SFRIFG1 & OFIFG);              // Exit only when everything is ok
-
-    UCSCTL5 = DIVPA_1 | DIVA_0 | DIVM_0; //Divide ACLK por 2.
-
-    UCSCTL4 = SELA__XT1CLK    |             // ACLK  = XT1   =>      16.384 Hz
-              SELS__XT2CLK    |             // SMCLK = XT2   =>   4.000.000 Hz
-              SELM__DCOCLK;                 // MCLK  = DCO   =>  25.000.000 Hz
-
-}
-
 // FUNÇÕES DE TESTE
 volatile char __test_password[PASSWORD_LEN] = "12345";
 volatile int __test_password_idx = 0;
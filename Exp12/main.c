@@ -1,15 +1,18 @@
 #include <msp430.h> 
 #include <inttypes.h>
 
-#define LCD_ADDRESS 0x27
-#define MSP_ADDRESS 0x42
+// Árvore de clocks configurada pelo clockInit
+#define ACLK_HZ 32768UL
+#define SMCLK_HZ 4000000UL
+#define MCLK_HZ 25000000UL
+#include "../Common/clocks.h"
+#include "../Common/power.h"  // DVFS; inclui clock_init.h
 
-#define FLLN(x) ((x)-1)
-void clockInit();
-void pmmVCore (unsigned int level);
+#define LCD_I2C_SCL_HZ 100000UL // Máximo do PCF8574
+CLOCK_STATIC_ASSERT(I2C_BR(SMCLK_HZ, LCD_I2C_SCL_HZ) >= 4, lcd_i2c_scl_too_fast);
 
-#define to_high_nibble(b) ((b & 0xf) << 4)
-#define to_low_nibble(b) ((b & 0xf))
+#define LCD_I2C_ADDRESS 0x27
+#define MSP_ADDRESS 0x42
 
 typedef uint8_t bool;
 const bool true = 1;
@@ -17,38 +20,94 @@ const bool false = 0;
 
 typedef uint8_t byte;
 
-typedef struct {
-    bool backlight_on;
-    byte address;
-    byte buffer[2][16];
-} LCD;
-
-#define LCD_ENABLE_BIT BIT2
-#define LCD_BACKLIGHT_BIT BIT3
-#define LCD_SET_DDRAM_ADDRESS_BIT BIT7
-
 // Low level I2C
 void initialize_I2C_UCB0_MasterTransmitter();
 void initialize_I2C_UCB1_SlaveReceiver();
-void master_TransmitOneByte(unsigned char address, unsigned char data);
 void delay_us(unsigned int time_us);
 
-// Low level LCD
-LCD initialize_lcd(byte address);
-byte assemble_byte_from_lcd_nibble(LCD* lcd, byte nibble, bool is_instruction);
-void lcd_send_raw_byte(LCD* lcd, byte b);
-void lcd_send_nibble(LCD* lcd, byte nibble, bool is_instruction);
-void lcd_send_byte(LCD* lcd, byte b, bool is_instruction);
-
-// High level LCD
-void lcd_set_cursor_position(LCD* lcd, byte row, byte col);
-void lcd_write_char(LCD* lcd, byte c);
-void lcd_clear(LCD* lcd);
-
-// LCD Buffer
-#define LCD_EMPTY_CHAR (0x20)
-void lcd_flush(LCD* lcd);
-
+// LCD 16x2 no PCF8574 (Common/lcd.h). O driver usa o UCB0 e o TA1 (o TB0 é da troca de clocks)
+#define LCD_WAIT_TIMER_CTL TA1CTL
+#define LCD_WAIT_TIMER_CCR0 TA1CCR0
+#define LCD_WAIT_TIMER_CCTL0 TA1CCTL0
+#define LCD_WAIT_TIMER_START (TASSEL__ACLK | MC_1 | TACLR)
+#define LCD_WAIT_TIMER_STOP (MC_0 | TACLR)
+#define LCD_WAIT_TIMER_VECTOR TIMER1_A0_VECTOR
+#include "../Common/lcd.h"
+
+// O que fazer com o que chega no UCB1 (MSP_ADDRESS):
+//  BRIDGE_BUFFER    1 caractere por escrita, no buffer em ordem + lcd_flush (original)
+//  BRIDGE_TERMINAL  1 caractere por escrita direto na posição do cursor (custo constante)
+//  BRIDGE_SERVER    1 comando por transação (ver server_execute), vários viram um só lcd_flush
+#define BRIDGE_BUFFER 0
+#define BRIDGE_TERMINAL 1
+#define BRIDGE_SERVER 2
+#define BRIDGE_MODE BRIDGE_SERVER
+
+// As linhas formam um anel: a do cursor é a mais nova, a outra é a anterior.
+// Cada linha usa as 40 colunas da DDRAM; passando da janela de LCD_COLS, o display shift
+// acompanha o cursor (o HD44780 desloca as duas linhas juntas).
+typedef struct {
+    byte row;                   // Linha do cursor
+    byte col;                   // Coluna na linha da DDRAM (0..LCD_DDRAM_LINE_LENGTH)
+    byte shift;                 // Colunas deslocadas pelo display shift
+    byte used[LCD_ROWS];        // Colunas da DDRAM com texto em cada linha, visíveis ou não
+} Terminal;
+
+// Linhas de 40 colunas e display shift das duas juntas: só no modo de 2 linhas do HD44780
+CLOCK_STATIC_ASSERT(LCD_ROWS == 2, terminal_needs_two_rows);
+
+// Recepção do UCB1 (slave) pela ISR num anel; o lado do LCD consome no seu ritmo.
+// Anel cheio: com UCB1_RX_STRETCH o RXBUF fica retido e o USCI segura o SCL (o master espera);
+// sem, o byte é descartado.
+#define UCB1_RX_STRETCH 1
+#define UCB1_RX_BUFFER_SIZE 64      // Potência de 2
+#define UCB1_RX_BUFFER_MASK (UCB1_RX_BUFFER_SIZE - 1)
+
+byte ucb1_rx_buffer[UCB1_RX_BUFFER_SIZE];
+volatile unsigned int ucb1_rx_head = 0;     // Escrito pela ISR
+volatile unsigned int ucb1_rx_tail = 0;     // Escrito por ucb1_rx_pop
+volatile bool ucb1_rx_stalled = false;      // RXBUF retido esperando espaço
+volatile unsigned long ucb1_rx_bytes = 0;
+volatile unsigned int ucb1_rx_stretched = 0;    // Vezes que o anel encheu e o SCL foi segurado
+volatile unsigned int ucb1_rx_dropped = 0;      // Bytes perdidos (sem UCB1_RX_STRETCH)
+volatile unsigned int ucb1_rx_max_used = 0;     // Maior ocupação do anel
+
+void ucb1_rx_push(byte c);
+bool ucb1_rx_available();
+byte ucb1_rx_pop();
+
+// Servidor de display: a ISR marca o fim de cada transação (STOP ou repeated START) num anel
+// de comprimentos. Cada transação tem >= 1 byte no anel de bytes, então esse anel nunca enche.
+// Bytes além de SERVER_MAX_COMMAND numa transação são descartados, para um comando nunca
+// ocupar o anel de bytes inteiro (o consumidor só lê comandos completos).
+#define SERVER_MAX_COMMAND 32
+#define SERVER_CMD_WRITE 0x01       // [0x01, linha, coluna, caracteres...]
+#define SERVER_CMD_CLEAR 0x02       // [0x02, linha, coluna, comprimento]
+#define SERVER_CMD_BAR 0x03         // [0x03, linha, coluna, largura, valor 0..255]
+#define SERVER_CMD_GLYPH 0x04       // [0x04, slot 4..7, 8 linhas]
+                                    // Primeiro byte >= 0x20: texto na posição implícita
+#define SERVER_BAR_GLYPHS 4         // Slots 0..3: barra com 1..4 colunas de pixels
+
+byte ucb1_rx_lengths[UCB1_RX_BUFFER_SIZE];
+volatile unsigned int ucb1_rx_lengths_head = 0;
+volatile unsigned int ucb1_rx_lengths_tail = 0;
+volatile unsigned int ucb1_rx_current = 0;      // Bytes da transação em andamento já no anel
+volatile bool ucb1_rx_corrupt = false;          // Transação em andamento perdeu um byte
+volatile unsigned int server_discarded = 0;     // Transações descartadas por bytes perdidos
+volatile unsigned int server_commands = 0;
+volatile unsigned int server_errors = 0;        // Comandos desconhecidos ou fora da tela
+volatile unsigned int server_flushes = 0;
+byte server_row = 0;                            // Posição implícita do texto
+byte server_col = 0;
+
+void ucb1_rx_end_transaction();
+bool server_command_available();
+void server_init(LCD* lcd);
+void server_execute_next(LCD* lcd);
+
+void terminal_init(Terminal* term);
+void terminal_newline(Terminal* term, LCD* lcd);
+void terminal_putc(Terminal* term, LCD* lcd, byte c);
 
 int main(void)
 {
@@ -59,24 +118,85 @@ int main(void)
     initialize_I2C_UCB0_MasterTransmitter();
     initialize_I2C_UCB1_SlaveReceiver();
 
-    LCD lcd = initialize_lcd(LCD_ADDRESS);
+    // Troca de clocks (TB0) e fila do LCD (UCB0/TA1) em segundo plano
+    __enable_interrupt();
+
+    power_init();
+
+    LCD lcd = initialize_lcd(LCD_I2C_ADDRESS);
+#if BRIDGE_MODE == BRIDGE_SERVER
+    bool dirty = false;
+    server_init(&lcd);
+
+    while(1) {
+        // Aplica todos os comandos pendentes no buffer; um único flush manda só o que mudou
+        while (server_command_available()) {
+            server_execute_next(&lcd);
+            dirty = true;
+        }
+
+        if (dirty && lcd_frame_done) {
+            lcd_flush(&lcd);
+            server_flushes++;
+            dirty = false;
+            continue;
+        }
+
+        // Nada a fazer: dorme em POWER_LOW até chegar um comando completo, ou até o LCD
+        // terminar o frame se há mudanças. O ponto só muda quando vai mesmo dormir.
+        __disable_interrupt();
+        if (!server_command_available() && !(dirty && lcd_frame_done)) {
+            power_set(POWER_LOW);
+            do {
+                __bis_SR_register(LPM0_bits | GIE);
+                __disable_interrupt();
+            } while (!server_command_available() && !(dirty && lcd_frame_done));
+            power_set(POWER_HIGH);
+        }
+        __enable_interrupt();
+    }
+#else
+#if BRIDGE_MODE == BRIDGE_TERMINAL
+    Terminal term;
+    terminal_init(&term);
+#else
     volatile int line = 0;
     volatile int col = 0;
+#endif
+
+    byte c;
 
     while(1) {
-        // Esperar receber um byte
-        while(!(UCB1IFG & UCRXIFG));
+        // Anel vazio: dorme em POWER_LOW até a ISR do UCB1 colocar algo nele.
+        // Com bytes no anel, consome um por volta sem trocar de ponto.
+        __disable_interrupt();
+        if (!ucb1_rx_available()) {
+            power_set(POWER_LOW);
+            do {
+                __bis_SR_register(LPM0_bits | GIE);
+                __disable_interrupt();
+            } while (!ucb1_rx_available());
+            power_set(POWER_HIGH);
+        }
+        __enable_interrupt();
+
+        c = ucb1_rx_pop();
 
+#if BRIDGE_MODE == BRIDGE_TERMINAL
+        terminal_putc(&term, &lcd, c);
+#else
         // Escreve o byte no LCD
-        lcd.buffer[line][col] = UCB1RXBUF;
+        lcd.buffer[line][col] = c;
 
-        col = (col + 1) % 16;
+        col = (col + 1) % LCD_COLS;
         if (col == 0) {
-            line = (line + 1) % 2;
+            line = (line + 1) % LCD_ROWS;
         }
 
         lcd_flush(&lcd);
+#endif
     }
+#endif
 
     return 0;
 }
@@ -107,8 +227,8 @@ void initialize_I2C_UCB0_MasterTransmitter()
                 UCSWRST ;             //Mantém o módulo desligado
 
     //Divisor de clock para o BAUDRate
-    UCB0BR0 = 2;
-    UCB0BR1 = 0;
+    UCB0BR0 = I2C_BR0(SMCLK_HZ, LCD_I2C_SCL_HZ);
+    UCB0BR1 = I2C_BR1(SMCLK_HZ, LCD_I2C_SCL_HZ);
 
     //Liga o módulo.
     UCB0CTL1 &= ~UCSWRST;
@@ -138,117 +258,309 @@ void initialize_I2C_UCB1_SlaveReceiver()
 
     //Liga o módulo.
     UCB1CTL1 &= ~UCSWRST;
+
+#if BRIDGE_MODE == BRIDGE_SERVER
+    UCB1IE = UCRXIE | UCSTTIE | UCSTPIE;
+#else
+    UCB1IE = UCRXIE;
+#endif
 }
 
-LCD initialize_lcd(byte address)
+void ucb1_rx_push(byte c)
 {
-    LCD lcd;
-    lcd.address = LCD_ADDRESS;
-    lcd.backlight_on = true;
-
-    lcd_send_nibble(&lcd, 0x03, true);
-    lcd_send_nibble(&lcd, 0x03, true);
-    lcd_send_nibble(&lcd, 0x03, true);
-    lcd_send_nibble(&lcd, 0x02, true);
-
-    lcd_send_byte(&lcd, 0x28, true);
-    lcd_send_byte(&lcd, 0x08, true);
-    lcd_clear(&lcd);
-    lcd_send_byte(&lcd, 0x06, true);
-    lcd_send_byte(&lcd, 0x0F, true);
-
-    return lcd;
+    unsigned int used;
+
+    ucb1_rx_buffer[ucb1_rx_head] = c;
+    ucb1_rx_head = (ucb1_rx_head + 1) & UCB1_RX_BUFFER_MASK;
+    ucb1_rx_bytes++;
+#if BRIDGE_MODE == BRIDGE_SERVER
+    ucb1_rx_current++;      // Só conta o que entrou no anel (o retido conta ao sair do RXBUF)
+#endif
+
+    used = (ucb1_rx_head - ucb1_rx_tail) & UCB1_RX_BUFFER_MASK;
+    if (used > ucb1_rx_max_used) {
+        ucb1_rx_max_used = used;
+    }
 }
 
-byte assemble_byte_from_lcd_nibble(LCD* lcd, byte nibble, bool is_instruction)
+bool ucb1_rx_available()
 {
-    volatile byte result = is_instruction? 0x00 : 0x01;
-    result |= to_high_nibble(nibble);
-    result |= lcd->backlight_on? LCD_BACKLIGHT_BIT : 0;
-    return result;
+    return ucb1_rx_head != ucb1_rx_tail;
 }
 
-void lcd_send_nibble(LCD* lcd, byte nibble, bool is_instruction)
+/*
+ * Tira um byte do anel. Se havia um byte retido no RXBUF, agora ele cabe:
+ * lê (libera o SCL) e religa a interrupção.
+ */
+byte ucb1_rx_pop()
 {
-    volatile byte byte_to_send = assemble_byte_from_lcd_nibble(lcd, nibble, is_instruction);
-    lcd_send_raw_byte(lcd, byte_to_send);
+    byte c;
+    unsigned short interrupt_state = __get_interrupt_state();
+    __disable_interrupt();
+
+    c = ucb1_rx_buffer[ucb1_rx_tail];
+    ucb1_rx_tail = (ucb1_rx_tail + 1) & UCB1_RX_BUFFER_MASK;
+
+    if (ucb1_rx_stalled) {
+        ucb1_rx_stalled = false;
+        ucb1_rx_push(UCB1RXBUF);
+        UCB1IE |= UCRXIE;
+    }
+
+    __set_interrupt_state(interrupt_state);
+    return c;
 }
 
-void lcd_send_byte(LCD* lcd, byte b, bool is_instruction)
+#pragma vector = USCI_B1_VECTOR
+__interrupt void __ucb1_rx_interrupt(void)
 {
-    lcd_send_nibble(lcd, (b >> 4) & 0xf, is_instruction);
-    lcd_send_nibble(lcd, b & 0xf,      is_instruction);
+    switch (__even_in_range(UCB1IV, 12)) {
+#if BRIDGE_MODE == BRIDGE_SERVER
+        case 6: // STTIFG: começo de transação (ou repeated START)
+            ucb1_rx_end_transaction();
+            __bic_SR_register_on_exit(LPM0_bits);
+            break;
+        case 8: // STPIFG
+            ucb1_rx_end_transaction();
+            __bic_SR_register_on_exit(LPM0_bits);
+            break;
+#endif
+        case 10: // RXIFG
+#if BRIDGE_MODE == BRIDGE_SERVER
+            if (ucb1_rx_current >= SERVER_MAX_COMMAND) {
+                ucb1_rx_dropped++;
+                (void) UCB1RXBUF;
+                break;
+            }
+#endif
+            if (((ucb1_rx_head + 1) & UCB1_RX_BUFFER_MASK) == ucb1_rx_tail) {
+#if UCB1_RX_STRETCH
+                // Não lê o RXBUF: o USCI segura o SCL até ucb1_rx_pop liberar espaço
+                ucb1_rx_stalled = true;
+                ucb1_rx_stretched++;
+                UCB1IE &= ~UCRXIE;
+#else
+                ucb1_rx_dropped++;
+                (void) UCB1RXBUF;
+#if BRIDGE_MODE == BRIDGE_SERVER
+                ucb1_rx_corrupt = true;
+#endif
+#endif
+            } else {
+                ucb1_rx_push(UCB1RXBUF);
+            }
+            __bic_SR_register_on_exit(LPM0_bits);
+            break;
+        default:
+            break;
+    }
 }
 
-void lcd_send_raw_byte(LCD* lcd, byte b)
+/*
+ * Fecha a transação em andamento (chamada da ISR no START seguinte ou no STOP).
+ * Se ela perdeu um byte (anel cheio sem UCB1_RX_STRETCH), o comando está truncado: os bytes
+ * dela saem do anel. O consumidor só lê transações fechadas, então recuar a cabeça é seguro.
+ */
+void ucb1_rx_end_transaction()
 {
-    master_TransmitOneByte(lcd->address, b);
-    delay_us(1000);
-    master_TransmitOneByte(lcd->address, b | LCD_ENABLE_BIT);
-    delay_us(2000);
-    master_TransmitOneByte(lcd->address, b);
-    delay_us(1000);
+    if (ucb1_rx_corrupt) {
+        ucb1_rx_corrupt = false;
+        ucb1_rx_head = (ucb1_rx_head - ucb1_rx_current) & UCB1_RX_BUFFER_MASK;
+        ucb1_rx_current = 0;
+        server_discarded++;
+        return;
+    }
+    if (ucb1_rx_current == 0) {
+        return;
+    }
+    ucb1_rx_lengths[ucb1_rx_lengths_head] = ucb1_rx_current;
+    ucb1_rx_lengths_head = (ucb1_rx_lengths_head + 1) & UCB1_RX_BUFFER_MASK;
+    ucb1_rx_current = 0;
 }
 
-void lcd_set_cursor_position(LCD* lcd, byte row, byte col)
+bool server_command_available()
 {
-    lcd_send_byte(lcd, (row * 0x40 + col) | LCD_SET_DDRAM_ADDRESS_BIT, true);
+    return ucb1_rx_lengths_head != ucb1_rx_lengths_tail;
 }
 
-void lcd_write_char(LCD* lcd, byte c)
+/*
+ * Define os glifos parciais da barra: slot k tem k + 1 colunas acesas a partir da esquerda.
+ */
+void server_init(LCD* lcd)
 {
-    lcd_send_byte(lcd, c, false);
+    byte rows[8];
+    byte k, i;
+    for (k = 0; k < SERVER_BAR_GLYPHS; k++) {
+        for (i = 0; i < 8; i++) {
+            rows[i] = (0x1F << (4 - k)) & 0x1F;
+        }
+        lcd_define_glyph(lcd, k, rows);
+    }
 }
 
-void lcd_clear(LCD* lcd)
+/*
+ * Tira um comando completo do anel e aplica no buffer do LCD (sem flush).
+ */
+void server_execute_next(LCD* lcd)
 {
-    volatile int i, j;
-    for (i = 0; i < 2; i++) {
-        for (j = 0; j < 16; j++) {
-            lcd->buffer[i][j] = LCD_EMPTY_CHAR;
+    byte cmd[SERVER_MAX_COMMAND];
+    byte length, i;
+    byte row, col, width, full, part;
+    unsigned int pixels;
+
+    length = ucb1_rx_lengths[ucb1_rx_lengths_tail];
+    for (i = 0; i < length; i++) {
+        cmd[i] = ucb1_rx_pop();
+    }
+    ucb1_rx_lengths_tail = (ucb1_rx_lengths_tail + 1) & UCB1_RX_BUFFER_MASK;
+    server_commands++;
+
+    // Texto puro: continua da posição implícita, quebrando linha no fim
+    if (cmd[0] >= 0x20) {
+        for (i = 0; i < length; i++) {
+            lcd->buffer[server_row][server_col] = cmd[i];
+            server_col = (server_col + 1) % LCD_COLS;
+            if (server_col == 0) {
+                server_row = (server_row + 1) % LCD_ROWS;
+            }
+        }
+        return;
+    }
+
+    if (cmd[0] != SERVER_CMD_GLYPH) {
+        if (length < 3 || cmd[1] >= LCD_ROWS || cmd[2] >= LCD_COLS) {
+            server_errors++;
+            return;
         }
+        row = cmd[1];
+        col = cmd[2];
     }
 
-    lcd_send_byte(lcd, 0x1, true);
+    switch (cmd[0]) {
+        case SERVER_CMD_WRITE:
+            for (i = 3; i < length && col < LCD_COLS; i++, col++) {
+                lcd->buffer[row][col] = cmd[i];
+            }
+            server_row = row;
+            server_col = col % LCD_COLS;
+            break;
+        case SERVER_CMD_CLEAR:
+            if (length < 4) {
+                server_errors++;
+                break;
+            }
+            for (i = 0; i < cmd[3] && col < LCD_COLS; i++, col++) {
+                lcd->buffer[row][col] = LCD_EMPTY_CHAR;
+            }
+            break;
+        case SERVER_CMD_BAR:
+            if (length < 5) {
+                server_errors++;
+                break;
+            }
+            width = cmd[3] < LCD_COLS - col? cmd[3] : LCD_COLS - col;
+            pixels = ((unsigned int) cmd[4] * width * 5 + 127) / 255;
+            full = pixels / 5;
+            part = pixels % 5;
+            for (i = 0; i < width; i++) {
+                if (i < full) {
+                    lcd->buffer[row][col + i] = 0xFF;               // Bloco cheio (ROM A00)
+                } else if (i == full && part > 0) {
+                    lcd->buffer[row][col + i] = part - 1;           // Glifo parcial
+                } else {
+                    lcd->buffer[row][col + i] = LCD_EMPTY_CHAR;
+                }
+            }
+            break;
+        case SERVER_CMD_GLYPH:
+            if (length < 10 || cmd[1] < SERVER_BAR_GLYPHS || cmd[1] > 7) {
+                server_errors++;
+                break;
+            }
+            lcd_define_glyph(lcd, cmd[1], &cmd[2]);
+            break;
+        default:
+            server_errors++;
+            break;
+    }
 }
 
-void lcd_flush(LCD* lcd)
+void terminal_init(Terminal* term)
 {
-    volatile int i, j;
-    for (i = 0; i < 2; i++) {
-        for (j = 0; j < 16; j++) {
-            lcd_set_cursor_position(lcd, i, j);
-            lcd_write_char(lcd, lcd->buffer[i][j]);
-        }
+    byte i;
+    term->row = 0;
+    term->col = 0;
+    term->shift = 0;
+    for (i = 0; i < LCD_ROWS; i++) {
+        term->used[i] = 0;
     }
 }
 
-void master_TransmitOneByte(unsigned char address, unsigned char data)
+/*
+ * Passa para a próxima linha do anel: desfaz o shift (return home), apaga o texto antigo
+ * dessa linha e posiciona o cursor no início. Apaga tudo o que foi escrito (até a linha
+ * inteira da DDRAM), não só a parte visível: o shift da linha nova traria o resto de volta.
+ * Custo limitado a LCD_DDRAM_LINE_LENGTH + 3 ops.
+ */
+void terminal_newline(Terminal* term, LCD* lcd)
 {
-    //Desligo todas as interrupções
-    UCB0IE = 0;
+    byte i, stale;
 
-    //Coloco o slave address
-    UCB0I2CSA = address;
+    term->row = (term->row + 1) % LCD_ROWS;
+    term->col = 0;
 
-    //Espero a linha estar desocupada.
-    if (UCB0STAT & UCBBUSY) return;
+    if (term->shift != 0) {
+        lcd_return_home(lcd);
+        term->shift = 0;
+    }
 
-    //Peço um START
-    UCB0CTL1 |= UCTXSTT;
+    // used nunca passa de LCD_DDRAM_LINE_LENGTH (terminal_putc troca de linha antes)
+    stale = term->used[term->row];
+    if (stale > 0) {
+        lcd_set_cursor_position(lcd, term->row, 0);
+        for (i = 0; i < stale; i++) {
+            lcd_write_char(lcd, LCD_EMPTY_CHAR);
+        }
+    }
+    term->used[term->row] = 0;
 
-    //Espero até o buffer de transmissão estar disponível
-    while ((UCB0IFG & UCTXIFG) == 0);
+    lcd_set_cursor_position(lcd, term->row, 0);
+}
 
-    //Escrevo o dado
-    UCB0TXBUF = data;
+/*
+ * Um caractere imprimível custa 1 op de dado (o endereço do HD44780 já avança sozinho),
+ * mais 1 display shift quando o cursor sai da janela. '\n' e '\r' trocam de linha;
+ * outros controles são ignorados.
+ */
+void terminal_putc(Terminal* term, LCD* lcd, byte c)
+{
+    if (c == '\n' || c == '\r') {
+        terminal_newline(term, lcd);
+        return;
+    }
+    if (c < 0x20) {
+        return;
+    }
+
+    if (term->col >= LCD_DDRAM_LINE_LENGTH) {
+        terminal_newline(term, lcd);
+    }
 
-    //Aguardo o acknowledge
-    while (UCB0CTL1 & UCTXSTT);
+    if (lcd->cursor_row != term->row || lcd->cursor_col != term->col) {
+        lcd_set_cursor_position(lcd, term->row, term->col);
+    }
 
-    UCB0CTL1 |= UCTXSTP;
+    lcd_write_char(lcd, c);
+    term->col++;
+    if (term->col > term->used[term->row]) {
+        term->used[term->row] = term->col;
+    }
 
-    return;
+    // Inclusive depois da última coluna da DDRAM: a janela termina nela e ela fica visível
+    if (term->col - term->shift > LCD_COLS) {
+        lcd_shift_display(lcd, true);
+        term->shift++;
+    }
 }
 
 /*
@@ -256,9 +568,9 @@ void master_TransmitOneByte(unsigned char address, unsigned char data)
  */
 void delay_us(unsigned int time_us)
 {
-    //Configure timer A0 and starts it.
+    //Configure timer A0 and starts it. SMCLK / ID ~ 1 MHz
     TA0CCR0 = time_us;
-    TA0CTL = TASSEL__SMCLK | ID__1 | MC_1 | TACLR;
+    TA0CTL = TASSEL__SMCLK | TIMER_US_ID(SMCLK_HZ) | MC_1 | TACLR;
 
     //Locks, waiting for the timer.
     while((TA0CTL & TAIFG) == 0);
@@ -267,69 +579,3 @@ void delay_us(unsigned int time_us)
     TA0CTL = MC_0 | TACLR;
 }
 
-
-// FUNÇÕES INALTERADAS ============================================
-void pmmVCore (unsigned int level)
-{
-#if defined (__MSP430F5529__)
-    PMMCTL0_H = 0xA5;                       // Open PMM registers for write access
-
-    SVSMHCTL =                              // Set SVS/SVM high side new level
-            SVSHE            +
-            SVSHRVL0 * level +
-            SVMHE            +
-            SVSMHRRL0 * level;
-
-    SVSMLCTL =                              // Set SVM low side to new level
-            SVSLE            +
-//          SVSLRVL0 * level +              // but not SVS, not yet..
-            SVMLE            +
-            SVSMLRRL0 * level;
-
-    while ((PMMIFG & SVSMLDLYIFG) == 0);    // Wait till SVM is settled
-
-    PMMIFG &= ~(SVMLVLRIFG + SVMLIFG);      // Clear already set flags
-
-    PMMCTL0_L = PMMCOREV0 * level;          // Set VCore to new level
-
-    if ((PMMIFG & SVMLIFG))                 // Wait till new level reached
-        while ((PMMIFG & SVMLVLRIFG) == 0);
-
-    SVSMLCTL =                              // Set SVS/SVM low side to new level
-            SVSLE            +
-            SVSLRVL0 * level +
-            SVMLE            +
-            SVSMLRRL0 * level;
-
-    PMMCTL0_H = 0x00;                       // Lock PMM registers for write access
-#endif
-}
-
-void clockInit()
-{
-    pmmVCore(1);
-    pmmVCore(2);
-    pmmVCore(3);
-
-    P5SEL |= BIT2 | BIT3 | BIT4 | BIT5;
-    UCSCTL0 = 0x00;
-    UCSCTL1 = DCORSEL_5;
-    UCSCTL2 = FLLD__1 | FLLN(25);
-    UCSCTL3 = SELREF__XT2CLK | FLLREFDIV__4;
-    UCSCTL6 = XT2DRIVE_2 | XT1DRIVE_2 | XCAP_3;
-    UCSCTL7 = 0;                            // Clear XT2,XT1,DCO fault flags
-
-    do {                                    // Check if all clocks are oscillating
-      UCSCTL7 &= ~(   XT2OFFG |             // Try to clear XT2,XT1,DCO fault flags,
-                    XT1LFOFFG |             // system fault flags and check if
-                       DCOFFG );            // oscillators are still faulty
-      SFRIFG1 &= ~OFIFG;                    //
-    } while (SFRIFG1 & OFIFG);              // Exit only when everything is ok
-
-    UCSCTL5 = DIVPA_1 | DIVA_0 | DIVM_0; //Divide ACLK por 2.
-
-    UCSCTL4 = SELA__XT1CLK    |             // ACLK  = XT1   =>      16.384 Hz
-              SELS__XT2CLK    |             // SMCLK = XT2   =>   4.000.000 Hz
-              SELM__DCOCLK;                 // MCLK  = DCO   =>  25.000.000 Hz
-
-}
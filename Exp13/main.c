@@ -1,5 +1,12 @@
 #include <msp430.h> 
 
+// Árvore de clocks configurada pelo clockInit
+#define ACLK_HZ 32768UL
+#define SMCLK_HZ 4000000UL
+#define MCLK_HZ 25000000UL
+#include "../Common/clocks.h"
+#include "../Common/power.h"  // DVFS; inclui clock_init.h
+
 #define SAMPLE_SIZE 128
 
 #define RED_LED_OFF (P1OUT &= ~BIT0)
@@ -10,11 +17,6 @@
 volatile unsigned int vector1[SAMPLE_SIZE];
 volatile unsigned int vector2[SAMPLE_SIZE];
 
-#define FLLN(x) ((x)-1)
-void clockInit();
-void pmmVCore (unsigned int level);
-
-
 void configure_leds();
 void configure_adc_trigger_clk();
 void configure_adc();
@@ -35,22 +37,30 @@ int main(void)
     configure_dma1();
     configure_dma2();
 
+    // Só para a troca de clocks em segundo plano (TB0) e a contagem de tempo por ponto de operação
+    power_init();
+    __enable_interrupt();
+
     // Ativa transferência no DMA1
     DMA1CTL |= DMAEN;
     while(1) {
         // Aguarda fim da transferência no DMA1
+        power_set(POWER_LOW);
         while (!(DMA1CTL & DMAIFG));
         // Ativa transferência no DMA2
         DMA2CTL &= ~DMAIFG;
         DMA2CTL |= DMAEN;
+        power_set(POWER_HIGH);
         update_leds_according_to_vec(vector1);
 
 
         // Aguarda fim da transferência no DMA2
+        power_set(POWER_LOW);
         while (!(DMA2CTL & DMAIFG));
         // Ativa transferência no DMA1
         DMA1CTL &= ~DMAIFG;
         DMA1CTL |= DMAEN;
+        power_set(POWER_HIGH);
         update_leds_according_to_vec(vector2);
     }
 
@@ -136,7 +146,7 @@ void configure_adc_trigger_clk()
     TA0CTL = TASSEL__ACLK | MC_1;
     TA0CCTL1 = OUTMOD_6;
 
-    TA0CCR0 = 256; // ACLK / 128 ~ 128Hz
+    TA0CCR0 = TIMER_CCR0(ACLK_HZ, 1, 128); // ACLK / 128 ~ 128Hz
     TA0CCR1 = TA0CCR0 >> 1; // 50% duty cycle
 }
 
@@ -185,69 +195,3 @@ void configure_adc()
     // Habilita o módulo ADC após configurações
     ADC12CTL0 |= ADC12ENC;
 }
-
-// FUNÇÕES INALTERADAS ======================================================
-void pmmVCore (unsigned int level)
-{
-#if defined (__MSP430F5529__)
-    PMMCTL0_H = 0xA5;                       // Open PMM registers for write access
-
-    SVSMHCTL =                              // Set SVS/SVM high side new level
-            SVSHE            +
-            SVSHRVL0 * level +
-            SVMHE            +
-            SVSMHRRL0 * level;
-
-    SVSMLCTL =                              // Set SVM low side to new level
-            SVSLE            +
-//          SVSLRVL0 * level +              // but not SVS, not yet..
-            SVMLE            +
-            SVSMLRRL0 * level;
-
-    while ((PMMIFG & SVSMLDLYIFG) == 0);    // Wait till SVM is settled
-
-    PMMIFG &= ~(SVMLVLRIFG + SVMLIFG);      // Clear already set flags
-
-    PMMCTL0_L = PMMCOREV0 * level;          // Set VCore to new level
-
-    if ((PMMIFG & SVMLIFG))                 // Wait till new level reached
-        while ((PMMIFG & SVMLVLRIFG) == 0);
-
-    SVSMLCTL =                              // Set SVS/SVM low side to new level
-            SVSLE            +
-            SVSLRVL0 * level +
-            SVMLE            +
-            SVSMLRRL0 * level;
-
-    PMMCTL0_H = 0x00;                       // Lock PMM registers for write access
-#endif
-}
-
-void clockInit()
-{
-    pmmVCore(1);
-    pmmVCore(2);
-    pmmVCore(3);
-
-    P5SEL |= BIT2 | BIT3 | BIT4 | BIT5;
-    UCSCTL0 = 0x00;
-    UCSCTL1 = DCORSEL_5;
-    UCSCTL2 = FLLD__1 | FLLN(25);
-    UCSCTL3 = SELREF__XT2CLK | FLLREFDIV__4;
-    UCSCTL6 = XT2DRIVE_2 | XT1DRIVE_2 | XCAP_3;
-    UCSCTL7 = 0;                            // Clear XT2,XT1,DCO fault flags
-
-    do {                                    // Check if all clocks are oscillating
-      UCSCTL7 &= ~(   XT2OFFG |             // Try to clear XT2,XT1,DCO fault flags,
-                    XT1LFOFFG |             // system fault flags and check if
-                       DCOFFG );            // oscillators are still faulty
-      SFRIFG1 &= ~OFIFG;                    //
-    } while (SFRIFG1 & OFIFG);              // Exit only when everything is ok
-
-    UCSCTL5 = DIVPA_1 | DIVA_0 | DIVM_0; //Divide ACLK por 2.
-
-    UCSCTL4 = SELA__XT1CLK    |             // ACLK  = XT1   =>      16.384 Hz
-              SELS__XT2CLK    |             // SMCLK = XT2   =>   4.000.000 Hz
-              SELM__DCOCLK;                 // MCLK  = DCO   =>  25.000.000 Hz
-
-}
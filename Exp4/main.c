@@ -1,5 +1,12 @@
 #include <msp430.h> 
 
+// Árvore de clocks padrão após o reset (sem clockInit)
+#define ACLK_HZ 32768UL
+#define SMCLK_HZ 1048576UL
+#include "../Common/clocks.h"
+
+#define HCSR04_TRIGGER_HZ 10
+
 // LEDS
 #define SET_RED_LED (P1OUT |= BIT0)
 #define RESET_RED_LED (P1OUT &= ~BIT0)
@@ -73,9 +80,9 @@ void config_timers(void)
 {
     // HC-SR04 Trigger
     TA0CTL = TASSEL__ACLK | MC__UP;
-    // For about 20 measures / second;
-    TA0CCR0 = 3276;
-    TA0CCR4 = 1638;
+    // For about 10 measures / second;
+    TA0CCR0 = TIMER_CCR0(ACLK_HZ, 1, HCSR04_TRIGGER_HZ);
+    TA0CCR4 = TA0CCR0 >> 1;
     // Output (PWM)
     TA0CCTL4 = OUTMOD_6;
     P1SEL |= BIT5;
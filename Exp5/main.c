@@ -1,5 +1,14 @@
 #include <msp430.h> 
 
+// Árvore de clocks padrão após o reset (sem clockInit)
+#define ACLK_HZ 32768UL
+#define SMCLK_HZ 1048576UL
+#include "../Common/clocks.h"
+
+// O UCB0 mestre roda do ACLK; UCBRx = 4 é o mínimo do USCI em modo mestre
+#define I2C_SCL_HZ 8192UL
+CLOCK_STATIC_ASSERT(I2C_BR(ACLK_HZ, I2C_SCL_HZ) >= 4, i2c_scl_too_fast);
+
 #define bool int
 #define true 1
 #define false 0
@@ -22,18 +31,76 @@
 #define UCB1_ADDRESS 0x31
 #define UCB1_BYTE 0x44
 void initialize_I2C_UCB1_Slave();
-unsigned char ucb1_byteReceived;
-unsigned char ucb1_byteTransmitted;
+
+// Mapa de registradores do escravo UCB1
+// Escrita: [registro inicial] [dado] [dado] ... (auto-incremento)
+// Leitura: START repetido após escrever o registro inicial, lê com auto-incremento
+#define UCB1_REGISTER_COUNT 16 // Potência de 2: o ponteiro dá a volta com uma máscara
+#define UCB1_REGISTER_MASK (UCB1_REGISTER_COUNT - 1)
+#define UCB1_REG_PASSWORD 0x00
+#define UCB1_REG_LAST_RECEIVED 0x01
+#define UCB1_REG_MATCHES 0x02
+volatile unsigned char ucb1_registers[UCB1_REGISTER_COUNT];
+volatile unsigned char ucb1_register_pointer;
+volatile bool ucb1_expect_register;
+void ucb1_register_written(unsigned char reg, unsigned char value);
 
 volatile unsigned char ucb0_test_address;
 volatile unsigned char ucb0_data_received;
 bool ucb0_data_received_flag;
 void reset_vars();
 void configure_I2C_UCB0_Master(bool transmitter_mode);
-bool master_TransmitOneByte(unsigned char address, unsigned char data);
-void master_ReceiveOneByte(unsigned char address);
 void set_address_and_send_start_UCB0(unsigned char address);
 
+// Transações em rajada: vários bytes entre um START e um STOP
+// Com SCL = 8192 Hz (ACLK / UCB0BR0 = 4), cada byte custa 9 bits no barramento.
+// START + endereço + STOP (~11 bits) são pagos uma vez por transação, então uma rajada
+// de n bytes ocupa ~ 11 + 9n bits: ~ 900 B/s para rajadas longas.
+volatile const unsigned char* ucb0_tx_buffer;
+volatile unsigned int ucb0_tx_remaining;
+volatile unsigned char* ucb0_rx_buffer;
+volatile unsigned int ucb0_rx_remaining;
+volatile bool ucb0_transfer_done;
+volatile bool ucb0_transfer_nack;
+bool master_TransmitBytes(unsigned char address, const unsigned char* data, unsigned int length);
+bool master_ReceiveBytes(unsigned char address, volatile unsigned char* buffer, unsigned int length);
+bool master_WriteRead(unsigned char address, const unsigned char* tx_data, unsigned int tx_length,
+                      volatile unsigned char* rx_buffer, unsigned int rx_length);
+bool master_WaitTransfer();
+bool master_BusReady();
+
+// Latência do pedido até o dado disponível, em ciclos de SMCLK (TA1 livre)
+volatile unsigned int ucb0_transfer_start;
+volatile unsigned int ucb0_transfer_latency;
+void start_latency_timer();
+void finish_transfer_UCB0(bool nack);
+
+// Leitura de 1 byte: o STOP tem que ser pedido enquanto o byte chega, logo depois do ACK
+// do endereço (UCTXSTT volta a 0). Em vez de esperar em laço, o TA1.1 confere o UCTXSTT
+// a cada bit de SCL e pede o STOP na primeira vez que o encontra limpo.
+#define STOP_POLL_TICKS (SMCLK_HZ / I2C_SCL_HZ) // 1 bit de SCL em ticks de SMCLK (128)
+void schedule_single_byte_stop();
+
+// Varredura do barramento (não bloqueante)
+// ACLK = REFO = 32768 Hz, SCL = ACLK / 4 = 8192 Hz.
+// START + endereço + R/W + ACK + STOP ~ 11 bits ~ 1,3 ms ~ 44 ticks de ACLK.
+// O timeout por endereço é o dobro disso, então a varredura completa leva no máximo
+// 127 * 2,7 ms ~ 340 ms, mesmo com o barramento travado.
+#define SCAN_FIRST_ADDRESS 0x01
+#define SCAN_LAST_ADDRESS 0x7F
+#define SCAN_TIMEOUT_TICKS CLOCK_DIV_CEIL(2 * 11 * ACLK_HZ, I2C_ACHIEVED_SCL(ACLK_HZ, I2C_SCL_HZ))  // 88
+#define SCAN_STOP_TICKS CLOCK_DIV_CEIL(2 * ACLK_HZ, I2C_ACHIEVED_SCL(ACLK_HZ, I2C_SCL_HZ))      // STOP depois de um NACK (8)
+volatile unsigned char ucb0_scan_bitmap[16];
+volatile unsigned char ucb0_scan_address;
+volatile unsigned char ucb0_scan_timeouts;
+volatile bool ucb0_scan_nack;
+volatile bool ucb0_scan_issued; // O START do endereço atual saiu (barramento estava livre)
+volatile bool ucb0_scan_done;
+void start_scan_UCB0();
+void scan_probe_address_UCB0(unsigned char address);
+void scan_reset_UCB0();
+bool scan_address_responded(unsigned char address);
+
 void delay_us(unsigned int time_us);
 
 void configLED1()
@@ -72,28 +139,53 @@ int main(void)
 
     //Fase 1: Descobrir o endereço
 
-    while(!master_TransmitOneByte(ucb0_test_address, 0x1))
+    start_scan_UCB0();
+    while (!ucb0_scan_done);
+
+    while (ucb0_test_address <= SCAN_LAST_ADDRESS &&
+           !scan_address_responded(ucb0_test_address))
     {
         ucb0_test_address++;
     }
 
+    if (ucb0_test_address > SCAN_LAST_ADDRESS) {
+        // Nenhum dispositivo respondeu (ou o barramento ficou ocupado): para aqui com o LED1 aceso.
+        // ucb0_scan_timeouts diz quantos endereços não puderam ser testados.
+        LED1_ON;
+        status = 0xFF; //BREAKPOINT: nenhum dispositivo
+        while (1);
+    }
+
+    // A partir daqui a UCB0 não é mais reconfigurada: as transações só trocam UCTR
+    configure_I2C_UCB0_Master(true);
+    start_latency_timer();
+
     delay_us(50000);
     status = 1; //BREAKPOINT
 
     while(1)
     {
         ucb0_data_received_flag = false;
-        configure_I2C_UCB0_Master(false);
         //Fase 2:Descobrir o byte certo
-        //Peço para receber um byte
-        master_ReceiveOneByte(ucb0_test_address);
-
-        while (!ucb0_data_received_flag);
+        //Leio o registrador da senha numa única transação
+        const unsigned char password_register = UCB1_REG_PASSWORD;
+        if (!master_WriteRead(ucb0_test_address, &password_register, 1, &ucb0_data_received, 1) ||
+            !master_WaitTransfer()) {
+            // Barramento ocupado ou NACK: tenta de novo
+            continue;
+        }
 
         delay_us(50000);
         status = 2; //BREAKPOINT
 
         //Fase 3: Envio o byte correto.
+        unsigned char password_write[2];
+        password_write[0] = UCB1_REG_PASSWORD;
+        password_write[1] = ucb0_data_received;
+        if (master_TransmitBytes(ucb0_test_address, password_write, 2)) {
+            master_WaitTransfer();
+        }
+
         delay_us(50000);
         status = 3; //BREAKPOINT
     }
@@ -107,6 +199,8 @@ void reset_vars()
     ucb0_test_address = 0x01;
     ucb0_data_received = 0x00;
     ucb0_data_received_flag = 0x00;
+    ucb0_scan_done = true;
+    ucb0_transfer_done = true;
 }
 
 /*
@@ -138,8 +232,8 @@ void configure_I2C_UCB0_Master(bool transmitter_mode) {
        }
 
        // Baud rate clock divisor
-       UCB0BR0 = 2;
-       UCB0BR1 = 0;
+       UCB0BR0 = I2C_BR0(ACLK_HZ, I2C_SCL_HZ);
+       UCB0BR1 = I2C_BR1(ACLK_HZ, I2C_SCL_HZ);
 
        // Turn on the module
        UCB0CTL1 &= ~UCSWRST;
@@ -156,38 +250,182 @@ void set_address_and_send_start_UCB0(unsigned char address) {
     // Set the address
     UCB0I2CSA = address;
 
-    // Waits for the line to be idle
-    while (UCB0STAT & UCBBUSY);
-
-    // Send a START
+    // Send a START (master_BusReady() já conferiu o barramento)
     UCB0CTL1 |= UCTXSTT;
 }
 
-bool master_TransmitOneByte(unsigned char address, unsigned char data)
+/*
+ * Inicia a varredura de todos os endereços do barramento.
+ * Cada endereço recebe um START + endereço + STOP, sem dados. O NACK é tratado
+ * na interrupção da UCB0 e o ACK (ou o barramento travado) pelo timeout do TA1.
+ * Ao final, ucb0_scan_done = true e ucb0_scan_bitmap tem um bit por endereço que respondeu.
+ */
+void start_scan_UCB0()
 {
-        set_address_and_send_start_UCB0(address);
+    volatile int i;
+    for (i = 0; i < 16; i++) {
+        ucb0_scan_bitmap[i] = 0;
+    }
+    ucb0_scan_timeouts = 0;
+    ucb0_scan_done = false;
 
-        // Wait until the TX buffer is available
-        while ((UCB0IFG & UCTXIFG) == 0);
+    configure_I2C_UCB0_Master(true);
+    UCB0IE = UCNACKIE;
 
-        // Send the data
-        UCB0TXBUF = data;
+    // TA1 em modo contínuo: CCR0 é o deadline do endereço atual
+    TA1CTL = TASSEL__ACLK | MC__CONTINUOUS | TACLR;
+    TA1CCTL0 = CCIE;
 
-        // Wait for ACK
-        while (UCB0CTL1 & UCTXSTT);
+    scan_probe_address_UCB0(SCAN_FIRST_ADDRESS);
+}
 
-        volatile bool is_ack = ((UCB0IFG & UCNACKIFG) == 0);
-        UCB0CTL1 |= UCTXSTP;
+void scan_probe_address_UCB0(unsigned char address)
+{
+    ucb0_scan_address = address;
+    ucb0_scan_nack = false;
+    ucb0_scan_issued = false;
+    TA1CCR0 = TA1R + SCAN_TIMEOUT_TICKS;
 
-        return is_ack;
+    // Não espera o barramento: se estiver ocupado, o timeout conta o endereço como não testado
+    if (UCB0STAT & UCBBUSY) return;
+
+    UCB0I2CSA = address;
+    UCB0IFG &= ~UCNACKIFG;
+
+    // START + endereço + STOP, sem bytes de dados
+    ucb0_scan_issued = true;
+    UCB0CTL1 |= UCTR | UCTXSTT | UCTXSTP;
+}
+
+void scan_reset_UCB0()
+{
+    // Reset do módulo libera SDA/SCL. O reset também limpa UCB0IE.
+    UCB0CTL1 |= UCSWRST;
+    UCB0CTL1 &= ~UCSWRST;
+    UCB0IE = UCNACKIE;
 }
 
-void master_ReceiveOneByte(unsigned char address)
+bool scan_address_responded(unsigned char address)
 {
+    return (ucb0_scan_bitmap[address >> 3] & (1 << (address & 0x7))) != 0;
+}
+
+/*
+ * Envia length bytes numa única transação. Retorna logo após o START;
+ * os bytes são escritos na interrupção de UCTXIFG e o STOP é pedido após o último.
+ * O buffer tem que continuar válido até master_WaitTransfer().
+ * Retorna false, sem iniciar nada, se o barramento estiver ocupado.
+ */
+bool master_TransmitBytes(unsigned char address, const unsigned char* data, unsigned int length)
+{
+        return master_WriteRead(address, data, length, 0, 0);
+}
+
+/*
+ * Escreve tx_length bytes (ex.: endereço de registrador), gera um START repetido
+ * e lê rx_length bytes, tudo numa única transação. A troca de direção é feita
+ * na interrupção de UCTXIFG só alternando UCTR, sem passar por UCSWRST.
+ * Se ainda houver uma transação deste mestre em andamento, dorme em LPM0 até ela
+ * terminar; barramento ocupado por outro motivo retorna false em vez de esperar.
+ */
+bool master_WriteRead(unsigned char address, const unsigned char* tx_data, unsigned int tx_length,
+                      volatile unsigned char* rx_buffer, unsigned int rx_length)
+{
+        master_WaitTransfer();
+        if (!master_BusReady()) return false;
+
+        ucb0_tx_buffer = tx_data;
+        ucb0_tx_remaining = tx_length;
+        ucb0_rx_buffer = rx_buffer;
+        ucb0_rx_remaining = rx_length;
+        ucb0_transfer_nack = false;
+        ucb0_transfer_done = false;
+        ucb0_transfer_start = TA1R;
+
+        UCB0CTL1 |= UCTR;
+        UCB0IFG &= ~(UCTXIFG | UCRXIFG | UCNACKIFG);
+        UCB0IE |= UCTXIE | UCNACKIE;
+
         set_address_and_send_start_UCB0(address);
+        return true;
+}
 
-        // The other actions will happen inside interrupts
-        return;
+/*
+ * Recebe length bytes numa única transação. O STOP é pedido durante a recepção
+ * do último byte, então o mestre responde NACK só no final.
+ */
+bool master_ReceiveBytes(unsigned char address, volatile unsigned char* buffer, unsigned int length)
+{
+        master_WaitTransfer();
+        if (!master_BusReady()) return false;
+
+        ucb0_rx_buffer = buffer;
+        ucb0_rx_remaining = length;
+        ucb0_tx_remaining = 0;
+        ucb0_transfer_nack = false;
+        ucb0_transfer_done = false;
+        ucb0_transfer_start = TA1R;
+
+        UCB0CTL1 &= ~UCTR;
+        UCB0IFG &= ~(UCRXIFG | UCNACKIFG);
+        UCB0IE |= UCRXIE | UCNACKIE;
+
+        set_address_and_send_start_UCB0(address);
+
+        if (length == 1) {
+            // Um único byte: o STOP tem que ir logo depois do endereço
+            schedule_single_byte_stop();
+        }
+        return true;
+}
+
+/*
+ * Dorme em LPM0 até a transação atual terminar (a interrupção da UCB0 acorda).
+ * Retorna false se o escravo respondeu NACK.
+ */
+bool master_WaitTransfer()
+{
+        unsigned short interrupt_state = __get_interrupt_state();
+        __disable_interrupt();
+        while (!ucb0_transfer_done) {
+            __bis_SR_register(LPM0_bits | GIE);
+            __disable_interrupt();
+        }
+        __set_interrupt_state(interrupt_state);
+        return !ucb0_transfer_nack;
+}
+
+/*
+ * Espera só o STOP que este mestre acabou de pedir (UCTXSTP, uns poucos bits de SCL).
+ * Retorna false se o barramento continua ocupado: outro mestre ou SDA/SCL presos.
+ */
+bool master_BusReady()
+{
+        while (UCB0CTL1 & UCTXSTP);
+        return (UCB0STAT & UCBBUSY) == 0;
+}
+
+/*
+ * TA1 livre em SMCLK, usado só como base de tempo para ucb0_transfer_latency.
+ */
+void start_latency_timer()
+{
+        TA1CCTL0 = 0;
+        TA1CTL = TASSEL__SMCLK | ID__1 | MC__CONTINUOUS | TACLR;
+}
+
+void schedule_single_byte_stop()
+{
+        TA1CCR1 = TA1R + STOP_POLL_TICKS;
+        TA1CCTL1 = CCIE;
+}
+
+void finish_transfer_UCB0(bool nack)
+{
+        UCB0IE &= ~(UCTXIE | UCRXIE);
+        ucb0_transfer_latency = TA1R - ucb0_transfer_start;
+        ucb0_transfer_nack = nack;
+        ucb0_transfer_done = true;
 }
 
 #pragma vector = USCI_B0_VECTOR;
@@ -198,14 +436,95 @@ __interrupt void i2c_b0_isr() {
      case USCI_I2C_UCALIFG:
          break;
      case USCI_I2C_UCNACKIFG:
+         if (!ucb0_scan_done) {
+             // Ninguém respondeu: só espera o STOP e passa para o próximo
+             ucb0_scan_nack = true;
+             TA1CCR0 = TA1R + SCAN_STOP_TICKS;
+         } else if (!ucb0_transfer_done) {
+             UCB0CTL1 |= UCTXSTP;
+             finish_transfer_UCB0(true);
+             __bic_SR_register_on_exit(LPM0_bits);
+         }
          break;
      case USCI_I2C_UCSTTIFG:
          break;
      case USCI_I2C_UCSTPIFG:
          break;
     case USCI_I2C_UCRXIFG:
-        ucb0_data_received = (unsigned char) UCB0RXBUF;
-        ucb0_data_received_flag = true;
+        *ucb0_rx_buffer++ = (unsigned char) UCB0RXBUF;
+        ucb0_rx_remaining--;
+        if (ucb0_rx_remaining == 1) {
+            UCB0CTL1 |= UCTXSTP;
+        } else if (ucb0_rx_remaining == 0) {
+            finish_transfer_UCB0(false);
+            ucb0_data_received_flag = true;
+            __bic_SR_register_on_exit(LPM0_bits);
+        }
+        break;
+    case USCI_I2C_UCTXIFG:
+        if (ucb0_tx_remaining > 0) {
+            UCB0TXBUF = *ucb0_tx_buffer++;
+            ucb0_tx_remaining--;
+        } else if (ucb0_rx_remaining > 0) {
+            // START repetido: só troca a direção
+            UCB0IE = (UCB0IE & ~UCTXIE) | UCRXIE;
+            UCB0CTL1 &= ~UCTR;
+            UCB0CTL1 |= UCTXSTT;
+
+            if (ucb0_rx_remaining == 1) {
+                // Um único byte: o STOP tem que ir logo depois do endereço
+                schedule_single_byte_stop();
+            }
+        } else {
+            UCB0CTL1 |= UCTXSTP;
+            finish_transfer_UCB0(false);
+            __bic_SR_register_on_exit(LPM0_bits);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+#pragma vector = TIMER1_A0_VECTOR;
+__interrupt void scan_timeout_isr()
+{
+    if (!ucb0_scan_issued) {
+        // Barramento ocupado: o endereço não foi testado, então não conta como ACK
+        ucb0_scan_timeouts++;
+    } else if (UCB0CTL1 & (UCTXSTT | UCTXSTP)) {
+        // START/STOP não terminou no tempo esperado: barramento travado
+        ucb0_scan_timeouts++;
+        scan_reset_UCB0();
+    } else if (!ucb0_scan_nack && !(UCB0IFG & UCNACKIFG)) {
+        ucb0_scan_bitmap[ucb0_scan_address >> 3] |= 1 << (ucb0_scan_address & 0x7);
+    }
+
+    if (ucb0_scan_address == SCAN_LAST_ADDRESS) {
+        TA1CCTL0 = 0;
+        TA1CTL = MC_0 | TACLR;
+        UCB0IE = 0;
+        ucb0_scan_done = true;
+        return;
+    }
+
+    scan_probe_address_UCB0(ucb0_scan_address + 1);
+}
+
+#pragma vector = TIMER1_A1_VECTOR;
+__interrupt void single_byte_stop_isr()
+{
+    switch (__even_in_range(TA1IV, 14)) {
+    case TA1IV_TACCR1:
+        if (UCB0CTL1 & UCTXSTT) {
+            // Endereço ainda não confirmado: confere de novo no próximo bit
+            TA1CCR1 += STOP_POLL_TICKS;
+            break;
+        }
+        TA1CCTL1 = 0;
+        if (!ucb0_transfer_done) {
+            UCB0CTL1 |= UCTXSTP;
+        }
         break;
     default:
         break;
@@ -259,20 +578,50 @@ void initialize_I2C_UCB1_Slave()
     UCB1BR1 = 0;
 
     //Prepara minhas variáveis.
-    ucb1_byteTransmitted = UCB1_BYTE;
-    ucb1_byteReceived = 0x00;
+    volatile int i;
+    for (i = 0; i < UCB1_REGISTER_COUNT; i++) {
+        ucb1_registers[i] = 0x00;
+    }
+    ucb1_registers[UCB1_REG_PASSWORD] = UCB1_BYTE;
+    ucb1_register_pointer = 0;
+    ucb1_expect_register = false;
 
     UCB1I2COA = UCB1_ADDRESS;
 
     //Liga o módulo.
     UCB1CTL1 &= ~UCSWRST;
 
-    //Liga as interrupções de TX e RX.
-    UCB1IE = UCTXIE | UCRXIE;
+    //Liga as interrupções de TX, RX e START (o primeiro byte escrito é o registro)
+    UCB1IE = UCTXIE | UCRXIE | UCSTTIE;
 
 }
 
 
+/*
+ * Escrita num registro do escravo. Só o registro da senha tem efeito colateral.
+ */
+void ucb1_register_written(unsigned char reg, unsigned char value)
+{
+    if (reg != UCB1_REG_PASSWORD) {
+        ucb1_registers[reg] = value;
+        return;
+    }
+
+    ucb1_registers[UCB1_REG_LAST_RECEIVED] = value;
+    if (value == ucb1_registers[UCB1_REG_PASSWORD])
+    {
+        LED1_OFF;
+        LED2_ON;
+        ucb1_registers[UCB1_REG_MATCHES]++;
+    } else
+    {
+        LED1_ON;
+        LED2_OFF;
+    }
+    //Toda vez que recebe um byte ele muda a senha
+    ucb1_registers[UCB1_REG_PASSWORD] += 0x03;
+}
+
 #pragma vector = USCI_B1_VECTOR;
 __interrupt void i2c_b1_isr()
 {
@@ -284,25 +633,26 @@ __interrupt void i2c_b1_isr()
     case USCI_I2C_UCNACKIFG:
         break;
     case USCI_I2C_UCSTTIFG:
+        // Numa escrita, o primeiro byte é o registro inicial.
+        // Numa leitura (START repetido), o ponteiro atual é mantido.
+        ucb1_expect_register = !(UCB1CTL1 & UCTR);
         break;
     case USCI_I2C_UCSTPIFG:
         break;
     case USCI_I2C_UCRXIFG:
-        ucb1_byteReceived = (unsigned char) UCB1RXBUF;
-        if (ucb1_byteReceived == ucb1_byteTransmitted)
-        {
-            LED1_OFF;
-            LED2_ON;
-        } else
-        {
-            LED1_ON;
-            LED2_OFF;
+        if (ucb1_expect_register) {
+            ucb1_register_pointer = UCB1RXBUF & UCB1_REGISTER_MASK;
+            ucb1_expect_register = false;
+            break;
         }
-        //Toda vez que recebe um byte ele muda a senha
-        ucb1_byteTransmitted += 0x03;
+        ucb1_register_written(ucb1_register_pointer, (unsigned char) UCB1RXBUF);
+        ucb1_register_pointer = (ucb1_register_pointer + 1) & UCB1_REGISTER_MASK;
         break;
     case USCI_I2C_UCTXIFG:
-        UCB1TXBUF = ucb1_byteTransmitted;
+        // O USCI pede o próximo byte antes do NACK do mestre, então o ponteiro
+        // termina um registro à frente do último lido.
+        UCB1TXBUF = ucb1_registers[ucb1_register_pointer];
+        ucb1_register_pointer = (ucb1_register_pointer + 1) & UCB1_REGISTER_MASK;
         break;
 
     default:
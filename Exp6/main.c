@@ -1,9 +1,14 @@
 #include <msp430.h> 
 #include <inttypes.h>
 
-#define FLLN(x) ((x)-1)
-void clockInit();
-void pmmVCore (unsigned int level);
+// Árvore de clocks configurada pelo clockInit
+#define ACLK_HZ 32768UL
+#define SMCLK_HZ 4000000UL
+#define MCLK_HZ 25000000UL
+#include "../Common/clocks.h"
+#include "../Common/clock_init.h"
+
+#define UART_BAUD 57600UL
 
 volatile uint16_t debouncing = 0;
 #define DEBOUNCE debouncing = 50000
@@ -14,15 +19,170 @@ volatile uint16_t debouncing = 0;
 #define GREEN_LED_ON P4OUT |= BIT7
 #define RED_LED_OFF P1OUT &= ~BIT0
 #define GREEN_LED_OFF P4OUT &= ~BIT7
-#define send_byte_uca0_sync(byte) while(!(UCA0IFG & UCTXIFG));UCA0TXBUF = (byte)
+
+// Fila de transmissão da UCA0, esvaziada pela interrupção de TX.
+// uart_uca0_send pode ser chamada do main ou de interrupções e nunca espera a UART.
+// Antes: cada botão esperava 3 bytes * 12 bits / 57600 ~ 625 us dentro da PORTx_VECTOR.
+// Agora: a PORTx_VECTOR só copia 3 bytes para a fila.
+// Tamanho: a potência de 2 seguinte a um quadro máximo (FRAME_MAX_PAYLOAD + 4) + 1 posição
+// que a fila nunca ocupa (head == tail é fila vazia). Conferido depois de FRAME_MAX_PAYLOAD.
+#define UCA0_TX_BUFFER_SIZE 64 // Potência de 2
+#define UCA0_TX_BUFFER_MASK (UCA0_TX_BUFFER_SIZE - 1)
+volatile uint8_t uca0_tx_buffer[UCA0_TX_BUFFER_SIZE];
+volatile uint8_t uca0_tx_head = 0; // Próxima posição livre
+volatile uint8_t uca0_tx_tail = 0; // Próximo byte a transmitir
+volatile uint16_t uca0_tx_dropped = 0;
+uint8_t uart_uca0_send(uint8_t byte);
 
 
 void initialize_uart_uca0();
 void initialize_uart_uca1();
 void initialize_leds_and_buttons();
 
-// Primeiro byte usado para contagem
-volatile uint8_t bytes_received[4] = { 0, 0, 0, 0 };
+// Protocolo de quadros: [SYNC] [LEN] [LEN bytes de payload] [CRC16 alto] [CRC16 baixo]
+// CRC16-CCITT (módulo CRC do chip, semente 0xFFFF) sobre LEN + payload.
+// Um byte perdido só invalida o quadro atual: o CRC falha e o parser volta a procurar SYNC.
+// A 57600 baud com paridade e 2 stop bits, um quadro de 3 bytes de payload tem
+// 7 * 12 = 84 bits, ou seja, no máximo ~685 quadros/s no link.
+#define FRAME_SYNC 0x7E
+#define FRAME_MAX_PAYLOAD 32
+#define FRAME_OVERHEAD 4 // SYNC + LEN + CRC16
+
+// Um quadro máximo tem que caber na fila de TX; índices de 8 bits
+CLOCK_STATIC_ASSERT((UCA0_TX_BUFFER_SIZE & UCA0_TX_BUFFER_MASK) == 0, uca0_tx_size_power_of_2);
+CLOCK_STATIC_ASSERT(UCA0_TX_BUFFER_SIZE - 1 >= FRAME_MAX_PAYLOAD + FRAME_OVERHEAD, uca0_tx_fits_frame);
+CLOCK_STATIC_ASSERT(UCA0_TX_BUFFER_SIZE / 2 - 1 < FRAME_MAX_PAYLOAD + FRAME_OVERHEAD, uca0_tx_next_power_of_2);
+CLOCK_STATIC_ASSERT(UCA0_TX_BUFFER_SIZE <= 256, uca0_tx_index_8_bits);
+
+typedef struct {
+    uint8_t sync;
+    uint8_t length;
+    uint8_t payload[FRAME_MAX_PAYLOAD + 2]; // + CRC, que o DMA recebe junto com o payload
+} UartFrame;
+
+typedef enum {
+    FRAME_WAIT_SYNC,
+    FRAME_WAIT_LENGTH,
+    FRAME_WAIT_PAYLOAD,
+    FRAME_WAIT_CRC_HIGH,
+    FRAME_WAIT_CRC_LOW
+} FrameParserState;
+
+// Dois quadros: a interrupção preenche um enquanto o main lê o outro (sem cópia)
+volatile UartFrame rx_frames[2];
+volatile uint8_t rx_frame_filling = 0;
+volatile UartFrame* volatile rx_frame_ready = 0;
+volatile FrameParserState rx_frame_state = FRAME_WAIT_SYNC;
+volatile uint8_t rx_frame_index = 0;
+volatile uint16_t rx_frame_crc = 0;
+volatile uint16_t rx_frame_received_crc = 0;
+volatile uint16_t rx_frames_ok = 0;
+volatile uint16_t rx_frames_crc_errors = 0;
+volatile uint16_t rx_frames_dropped = 0;
+
+uint16_t crc16_step(uint16_t crc, uint8_t byte);
+uint16_t crc16_block(uint16_t crc, const volatile uint8_t* data, uint8_t length);
+void uart_frame_receive_byte(uint8_t byte);
+void uart_frame_complete(volatile UartFrame* frame, uint16_t received_crc, uint16_t computed_crc);
+void uart_frame_release();
+uint8_t uart_uca0_send_frame(const uint8_t* payload, uint8_t length);
+void handle_frame(volatile UartFrame* frame);
+
+// Recepção da UCA1 por DMA: 1 = DMA em dois estágios, 0 = uma interrupção por byte
+// O DMA não detecta fim de quadro sozinho (a USCI não tem interrupção de linha ociosa e o
+// pino de RX não alimenta captura de timer), então usa o LEN do protocolo:
+//   estágio 1: DMA de 2 bytes [SYNC LEN], acorda e confere o cabeçalho;
+//   estágio 2: DMA de LEN + 2 bytes (payload + CRC), acorda e confere o CRC.
+// O TA1 é um prazo para o quadro inteiro, armado no estágio 2 (não é detecção de linha
+// ociosa): se o corpo não chegar no tempo esperado + UART_DEADLINE_SLACK_CHARS, o quadro é
+// descartado como truncado e a busca do cabeçalho recomeça.
+//
+// Carga de CPU por KB recebido, MCLK = 25 MHz. Estimativa por contagem de instruções
+// (entrada + RETI = 11 ciclos, DMA = 2 ciclos roubados por byte), não medida na placa;
+// uca1_rx_wakeups / uca1_rx_bytes dão as acordadas por KB reais nos dois modos.
+//   Por byte: ~110 ciclos por byte (despacho, contadores, máquina de estados, crc16_step)
+//             => 1024 acordadas, ~113k ciclos/KB (~4,5 ms).
+//   DMA, payload de 32 (36 bytes): cabeçalho ~90 + corpo ~120 + 9 por byte de CRC
+//             (crc16_block) + 72 de DMA ~ 580 ciclos/quadro
+//             => ~57 acordadas, ~16k ciclos/KB (~0,7 ms).
+//   DMA, payload de 3 (7 bytes): ~260 ciclos/quadro => ~290 acordadas, ~38k ciclos/KB.
+#define UCA1_RX_USE_DMA 1
+#define UART_CHAR_TICKS UART_CHAR_TIMER_TICKS(SMCLK_HZ, 8, UART_BAUD, 12) // TA1 = SMCLK / 8
+#define UART_DEADLINE_SLACK_CHARS 2 // Folga além do tempo do corpo antes de desistir do quadro
+
+typedef enum {
+    DMA_RX_HEADER,  // Recebendo [SYNC LEN]
+    DMA_RX_LENGTH,  // SYNC achado fora de posição, recebendo só LEN
+    DMA_RX_BODY     // Recebendo payload + CRC
+} DmaRxStage;
+
+volatile DmaRxStage rx_dma_stage = DMA_RX_HEADER;
+volatile uint16_t rx_frames_truncated = 0;
+volatile uint16_t uca1_rx_wakeups = 0;
+volatile uint16_t uca1_rx_bytes = 0;
+void initialize_uart_uca1_dma();
+void rx_dma_arm(volatile uint8_t* destination, uint8_t size, DmaRxStage stage);
+
+// Auto-teste do loopback P3.3 (UCA0 TX) -> P4.2 (UCA1 RX)
+// Para cada baud rate e formato, envia SELF_TEST_BYTES bytes pseudo-aleatórios (LFSR)
+// com polling, conferindo cada byte recebido e os flags UCPE/UCFE/UCOE da UCA1.
+// Depois volta para a configuração normal e manda um quadro de resultado por configuração.
+// Modelo esperado: bytes/s = baud / (1 start + 8 dados + paridade + stop bits), sem erros.
+// Tests/uart_model.c calcula os números de cada configuração e confere uma captura dos relatórios.
+#define UART_SELF_TEST 0
+#define SELF_TEST_BYTES 256
+#define SELF_TEST_TIMER_HZ (SMCLK_HZ / 8) // TA1 = SMCLK / 8
+#define SELF_TEST_RX_TIMEOUT 0xFFFF // Iterações sem receber antes de considerar o byte perdido
+
+typedef struct {
+    uint32_t baud;
+    uint8_t br0;
+    uint8_t br1;
+    uint8_t mctl;
+} UartBaudConfig;
+
+typedef struct {
+    uint8_t ctl0;
+    uint8_t bits_per_char;
+} UartFormatConfig;
+
+#define SELF_TEST_BAUD(baud) { baud, UART_BR0(SMCLK_HZ, baud), UART_BR1(SMCLK_HZ, baud), UART_MCTL(SMCLK_HZ, baud) }
+const UartBaudConfig self_test_bauds[] = {
+    SELF_TEST_BAUD(9600UL),
+    SELF_TEST_BAUD(19200UL),
+    SELF_TEST_BAUD(38400UL),
+    SELF_TEST_BAUD(57600UL),
+    SELF_TEST_BAUD(115200UL),
+};
+#define SELF_TEST_BAUD_COUNT (sizeof(self_test_bauds) / sizeof(self_test_bauds[0]))
+
+const UartFormatConfig self_test_formats[] = {
+    { 0,                     10 }, // 8N1
+    { UCPEN | UCPAR,         11 }, // 8E1
+    { UCPEN | UCSPB,         12 }, // 8O2 (configuração normal do experimento)
+};
+#define SELF_TEST_FORMAT_COUNT (sizeof(self_test_formats) / sizeof(self_test_formats[0]))
+#define SELF_TEST_CONFIG_COUNT (SELF_TEST_BAUD_COUNT * SELF_TEST_FORMAT_COUNT)
+
+typedef struct {
+    uint32_t ticks;          // Duração em ciclos de TA1
+    uint16_t bytes_per_s;
+    uint16_t expected_bytes_per_s;
+    uint16_t parity_errors;
+    uint16_t framing_errors;
+    uint16_t overruns;
+    uint16_t mismatches;     // Bytes recebidos diferentes do enviado (ou perdidos)
+} UartSelfTestResult;
+
+UartSelfTestResult self_test_results[SELF_TEST_CONFIG_COUNT];
+uint8_t self_test_reported = SELF_TEST_CONFIG_COUNT;
+
+uint8_t lfsr_next(uint8_t state);
+uint32_t self_test_timestamp(uint16_t* overflows);
+void configure_uart_loopback(const UartBaudConfig* baud, const UartFormatConfig* format);
+void run_uart_self_test();
+void report_uart_self_test();
+uint8_t uart_uca0_free_space();
 
 /**
  * main.c
@@ -36,12 +196,26 @@ int main(void)
 	initialize_uart_uca1();
 	initialize_leds_and_buttons();
 
+#if UART_SELF_TEST
+	// A medida só vale com os cristais (SMCLK = XT2, o clock do modelo): espera a troca,
+	// que roda no TB0; a varredura depois roda com o GIE desligado
+	clockWaitCrystals();
+	run_uart_self_test();
+#endif
+
 	__enable_interrupt();
 
 	while(1) {
 	    if (IS_DEBOUNCING) {
 	        DO_DEBOUNCING_STEP;
 	    }
+
+	    report_uart_self_test();
+
+	    if (rx_frame_ready) {
+	        handle_frame(rx_frame_ready);
+	        uart_frame_release();
+	    }
 	}
 
 	return 0;
@@ -73,12 +247,9 @@ void initialize_uart_uca0()
                UCSWRST;        //Mant�m reset.
 
     //BaudRate: 57600
-    UCA0BR0 = 4; //Low byte
-    UCA0BR1 = 0; //High byte
-    UCA0MCTL = UCBRS0 |
-               UCBRF2 | UCBRF0 |
-               UCOS16 |
-               0;
+    UCA0BR0 = UART_BR0(SMCLK_HZ, UART_BAUD); //Low byte
+    UCA0BR1 = UART_BR1(SMCLK_HZ, UART_BAUD); //High byte
+    UCA0MCTL = UART_MCTL(SMCLK_HZ, UART_BAUD);
 
     //Liga o m�dulo
     UCA0CTL1 &= ~UCSWRST;
@@ -119,19 +290,51 @@ void initialize_uart_uca1()
 
     //BaudRate: 57600
 
-    UCA1BR0 = 4; //Low byte
-    UCA1BR1 = 0; //High byte
-    UCA1MCTL = UCBRS0 |
-               UCBRF2 | UCBRF0 |
-               UCOS16 |
-               0;
+    UCA1BR0 = UART_BR0(SMCLK_HZ, UART_BAUD); //Low byte
+    UCA1BR1 = UART_BR1(SMCLK_HZ, UART_BAUD); //High byte
+    UCA1MCTL = UART_MCTL(SMCLK_HZ, UART_BAUD);
 
     //Liga o m�dulo
     UCA1CTL1 &= ~UCSWRST;
 
+#if UCA1_RX_USE_DMA
+    // O DMA lê UCA1RXBUF; a interrupção de RX competiria com ele
+    UCA1IE = 0;
+    initialize_uart_uca1_dma();
+#else
     UCA1IE =   UCTXIE | //Interrupt on transmission
                UCRXIE |   //Interrupt on Reception
                0;
+#endif
+}
+
+void initialize_uart_uca1_dma()
+{
+    DMACTL0 = (DMACTL0 & ~DMA0TSEL_31) | DMA0TSEL_20; // Disparo: UCA1RXIFG
+
+    // Byte a byte, fonte fixa, destino incrementando
+    DMA0CTL = DMADT_0 |
+              DMASRCINCR_0 |
+              DMADSTINCR_3 |
+              DMASBDB |
+              DMAIE;
+
+    DMA0SA = &UCA1RXBUF;
+
+    // Prazo do quadro, só roda durante o estágio 2 (corpo)
+    TA1CTL = TASSEL__SMCLK | ID__8 | MC_0 | TACLR;
+    TA1CCTL0 = 0;
+
+    rx_dma_arm(&rx_frames[rx_frame_filling].sync, 2, DMA_RX_HEADER);
+}
+
+void rx_dma_arm(volatile uint8_t* destination, uint8_t size, DmaRxStage stage)
+{
+    DMA0CTL &= ~DMAEN;
+    DMA0DA = destination;
+    DMA0SZ = size;
+    rx_dma_stage = stage;
+    DMA0CTL |= DMAEN;
 }
 
 void initialize_leds_and_buttons()
@@ -169,14 +372,367 @@ void initialize_leds_and_buttons()
     } while (P1IFG != 0);
 }
 
+/*
+ * Coloca um byte na fila de transmissão. Retorna 0 (e descarta o byte) se a fila estiver cheia.
+ */
+uint8_t uart_uca0_send(uint8_t byte)
+{
+    unsigned short interrupt_state = __get_interrupt_state();
+    __disable_interrupt();
+
+    uint8_t next_head = (uca0_tx_head + 1) & UCA0_TX_BUFFER_MASK;
+    if (next_head == uca0_tx_tail) {
+        uca0_tx_dropped++;
+        __set_interrupt_state(interrupt_state);
+        return 0;
+    }
+
+    uca0_tx_buffer[uca0_tx_head] = byte;
+    uca0_tx_head = next_head;
+
+    // Se a UART estiver livre, UCTXIFG já está setado e a interrupção começa a esvaziar a fila
+    UCA0IE |= UCTXIE;
+
+    __set_interrupt_state(interrupt_state);
+    return 1;
+}
+
+/*
+ * Um passo do CRC16-CCITT no módulo CRC. O CRC corrente fica numa variável,
+ * então TX (no main e nas interrupções de porta) e RX (na UCA1/DMA) podem usar o módulo
+ * intercalados. O passo em si (semente, dado, resultado) não pode ser interrompido por
+ * outro usuário do módulo.
+ */
+uint16_t crc16_step(uint16_t crc, uint8_t byte)
+{
+    unsigned short interrupt_state = __get_interrupt_state();
+    __disable_interrupt();
+    CRCINIRES = crc;
+    CRCDI_L = byte;
+    crc = CRCINIRES;
+    __set_interrupt_state(interrupt_state);
+    return crc;
+}
+
+/*
+ * CRC de um bloco inteiro numa única seção crítica: ~9 ciclos por byte em vez de uma
+ * chamada de crc16_step (com salva/restaura do GIE) por byte.
+ */
+uint16_t crc16_block(uint16_t crc, const volatile uint8_t* data, uint8_t length)
+{
+    unsigned short interrupt_state = __get_interrupt_state();
+    __disable_interrupt();
+    CRCINIRES = crc;
+    while (length--) {
+        CRCDI_L = *data++;
+    }
+    crc = CRCINIRES;
+    __set_interrupt_state(interrupt_state);
+    return crc;
+}
+
+/*
+ * Enfileira um quadro inteiro ou nada: quadros do main e das interrupções nunca se
+ * misturam na linha. Retorna 0 (e descarta o quadro) se não couber na fila.
+ */
+uint8_t uart_uca0_send_frame(const uint8_t* payload, uint8_t length)
+{
+    if (length > FRAME_MAX_PAYLOAD) return 0; // O receptor descartaria pelo LEN
+
+    // CRC antes, fora da seção crítica (cada passo já é atômico)
+    uint16_t crc = crc16_step(0xFFFF, length);
+    crc = crc16_block(crc, payload, length);
+    uint8_t i;
+
+    unsigned short interrupt_state = __get_interrupt_state();
+    __disable_interrupt();
+
+    if (uart_uca0_free_space() < length + FRAME_OVERHEAD) {
+        uca0_tx_dropped += length + FRAME_OVERHEAD;
+        __set_interrupt_state(interrupt_state);
+        return 0;
+    }
+
+    uart_uca0_send(FRAME_SYNC);
+    uart_uca0_send(length);
+    for (i = 0; i < length; i++) {
+        uart_uca0_send(payload[i]);
+    }
+    uart_uca0_send(crc >> 8);
+    uart_uca0_send(crc & 0xFF);
+
+    __set_interrupt_state(interrupt_state);
+    return 1;
+}
+
+/*
+ * Máquina de estados do receptor. Custo constante por byte.
+ */
+void uart_frame_receive_byte(uint8_t byte)
+{
+    volatile UartFrame* frame = &rx_frames[rx_frame_filling];
+
+    switch (rx_frame_state) {
+    case FRAME_WAIT_SYNC:
+        if (byte == FRAME_SYNC) {
+            rx_frame_state = FRAME_WAIT_LENGTH;
+        }
+        break;
+    case FRAME_WAIT_LENGTH:
+        if (byte > FRAME_MAX_PAYLOAD) {
+            rx_frame_state = (byte == FRAME_SYNC)? FRAME_WAIT_LENGTH : FRAME_WAIT_SYNC;
+            break;
+        }
+        frame->length = byte;
+        rx_frame_index = 0;
+        rx_frame_crc = crc16_step(0xFFFF, byte);
+        rx_frame_state = (byte == 0)? FRAME_WAIT_CRC_HIGH : FRAME_WAIT_PAYLOAD;
+        break;
+    case FRAME_WAIT_PAYLOAD:
+        frame->payload[rx_frame_index++] = byte;
+        rx_frame_crc = crc16_step(rx_frame_crc, byte);
+        if (rx_frame_index == frame->length) {
+            rx_frame_state = FRAME_WAIT_CRC_HIGH;
+        }
+        break;
+    case FRAME_WAIT_CRC_HIGH:
+        rx_frame_received_crc = (uint16_t) byte << 8;
+        rx_frame_state = FRAME_WAIT_CRC_LOW;
+        break;
+    case FRAME_WAIT_CRC_LOW:
+        rx_frame_received_crc |= byte;
+        rx_frame_state = FRAME_WAIT_SYNC;
+        uart_frame_complete(frame, rx_frame_received_crc, rx_frame_crc);
+        break;
+    }
+}
+
+/*
+ * Confere o CRC e entrega o quadro para o main, trocando o quadro em preenchimento.
+ */
+void uart_frame_complete(volatile UartFrame* frame, uint16_t received_crc, uint16_t computed_crc)
+{
+    if (received_crc != computed_crc) {
+        rx_frames_crc_errors++;
+        return;
+    }
+
+    if (rx_frame_ready) {
+        // O main ainda não liberou o quadro anterior
+        rx_frames_dropped++;
+        return;
+    }
+
+    rx_frames_ok++;
+    rx_frame_ready = frame;
+    rx_frame_filling ^= 1;
+}
+
+void uart_frame_release()
+{
+    rx_frame_ready = 0;
+}
+
+void handle_frame(volatile UartFrame* frame)
+{
+    if (frame->length != 3) {
+        RED_LED_OFF;
+        GREEN_LED_OFF;
+        return;
+    }
+
+    if (frame->payload[0] == 0x11 &&
+        frame->payload[1] == 0x22 &&
+        frame->payload[2] == 0x33) {
+        RED_LED_ON;
+    } else if (frame->payload[0] == 0xAA &&
+        frame->payload[1] == 0xBB &&
+        frame->payload[2] == 0xCC) {
+        GREEN_LED_ON;
+    } else {
+        RED_LED_OFF;
+        GREEN_LED_OFF;
+    }
+}
+
+uint8_t uart_uca0_free_space()
+{
+    return (uca0_tx_tail - uca0_tx_head - 1) & UCA0_TX_BUFFER_MASK;
+}
+
+// AUTO-TESTE DO LOOPBACK ============================================================
+uint8_t lfsr_next(uint8_t state)
+{
+    // LFSR de 8 bits, polinômio x^8 + x^6 + x^5 + x^4 + 1 (período 255)
+    uint8_t bit = ((state >> 7) ^ (state >> 5) ^ (state >> 4) ^ (state >> 3)) & 1;
+    return (state << 1) | bit;
+}
+
+void configure_uart_loopback(const UartBaudConfig* baud, const UartFormatConfig* format)
+{
+    UCA0CTL1 |= UCSWRST;
+    UCA1CTL1 |= UCSWRST;
+
+    UCA0CTL0 = format->ctl0 | UCMODE_0;
+    UCA1CTL0 = format->ctl0 | UCMODE_0;
+
+    UCA0BR0 = baud->br0;
+    UCA0BR1 = baud->br1;
+    UCA0MCTL = baud->mctl;
+    UCA1BR0 = baud->br0;
+    UCA1BR1 = baud->br1;
+    UCA1MCTL = baud->mctl;
+
+    UCA0CTL1 &= ~UCSWRST;
+    UCA1CTL1 = (UCA1CTL1 & ~UCSWRST) | UCRXEIE; // Bytes com erro também vão para o RXBUF
+
+    UCA0IE = 0;
+    UCA1IE = 0;
+}
+
+/*
+ * Roda toda a varredura com as interrupções desligadas. Ao final restaura a
+ * configuração normal das duas UARTs (e o DMA de recepção, se estiver ativo).
+ */
+/*
+ * TA1R de 32 bits: TA1R, TAIFG, TA1R de novo. Se o contador deu a volta entre as duas
+ * leituras, o TAIFG pode ter sido lido antes de subir: lê tudo outra vez.
+ */
+uint32_t self_test_timestamp(uint16_t* overflows)
+{
+    uint16_t before, after;
+    do {
+        before = TA1R;
+        if (TA1CTL & TAIFG) {
+            TA1CTL &= ~TAIFG;
+            (*overflows)++;
+        }
+        after = TA1R;
+    } while (after < before);
+    return ((uint32_t) *overflows << 16) | after;
+}
+
+void run_uart_self_test()
+{
+    DMA0CTL &= ~DMAEN;
+
+    volatile uint8_t b, f;
+    for (b = 0; b < SELF_TEST_BAUD_COUNT; b++) {
+        for (f = 0; f < SELF_TEST_FORMAT_COUNT; f++) {
+            const UartBaudConfig* baud = &self_test_bauds[b];
+            const UartFormatConfig* format = &self_test_formats[f];
+            UartSelfTestResult* result = &self_test_results[b * SELF_TEST_FORMAT_COUNT + f];
+
+            configure_uart_loopback(baud, format);
+            result->parity_errors = 0;
+            result->framing_errors = 0;
+            result->overruns = 0;
+            result->mismatches = 0;
+            result->expected_bytes_per_s = baud->baud / format->bits_per_char;
+
+            uint8_t tx_state = 1;
+            uint8_t rx_state = 1;
+            uint16_t sent = 0;
+            uint16_t received = 0;
+            uint16_t overflows = 0;
+            uint16_t idle = 0;
+
+            TA1CTL = TASSEL__SMCLK | ID__8 | MC__CONTINUOUS | TACLR;
+
+            while (received < SELF_TEST_BYTES) {
+                self_test_timestamp(&overflows);
+
+                if (sent < SELF_TEST_BYTES && (UCA0IFG & UCTXIFG)) {
+                    UCA0TXBUF = tx_state;
+                    tx_state = lfsr_next(tx_state);
+                    sent++;
+                }
+
+                if (!(UCA1IFG & UCRXIFG)) {
+                    if (++idle == SELF_TEST_RX_TIMEOUT) {
+                        // Byte perdido: conta e segue para o próximo
+                        result->mismatches++;
+                        rx_state = lfsr_next(rx_state);
+                        received++;
+                        idle = 0;
+                    }
+                    continue;
+                }
+                idle = 0;
+
+                // UCA1STAT tem que ser lido antes do RXBUF (a leitura do RXBUF limpa os flags)
+                uint8_t status = UCA1STAT;
+                uint8_t data = UCA1RXBUF;
+                if (status & UCPE) result->parity_errors++;
+                if (status & UCFE) result->framing_errors++;
+                if (status & UCOE) result->overruns++;
+                if (data != rx_state) result->mismatches++;
+
+                rx_state = lfsr_next(rx_state);
+                received++;
+            }
+
+            result->ticks = self_test_timestamp(&overflows);
+            TA1CTL = MC_0 | TACLR;
+            result->bytes_per_s = (SELF_TEST_BYTES * SELF_TEST_TIMER_HZ) / result->ticks;
+        }
+    }
+
+    initialize_uart_uca0();
+    initialize_uart_uca1();
+    self_test_reported = 0;
+}
+
+/*
+ * Envia um quadro de resultado por configuração, quando houver espaço na fila de TX:
+ * [índice] [baud/100 (2)] [bytes/s (2)] [esperado (2)] [paridade (2)] [framing (2)] [overrun (2)] [diferentes (2)]
+ */
+void report_uart_self_test()
+{
+    if (self_test_reported >= SELF_TEST_CONFIG_COUNT) return;
+    if (uart_uca0_free_space() < 4 + 15) return;
+
+    const UartSelfTestResult* result = &self_test_results[self_test_reported];
+    uint16_t baud = self_test_bauds[self_test_reported / SELF_TEST_FORMAT_COUNT].baud / 100;
+    uint8_t payload[15];
+    payload[0] = self_test_reported;
+    payload[1] = baud >> 8;
+    payload[2] = baud & 0xFF;
+    payload[3] = result->bytes_per_s >> 8;
+    payload[4] = result->bytes_per_s & 0xFF;
+    payload[5] = result->expected_bytes_per_s >> 8;
+    payload[6] = result->expected_bytes_per_s & 0xFF;
+    payload[7] = result->parity_errors >> 8;
+    payload[8] = result->parity_errors & 0xFF;
+    payload[9] = result->framing_errors >> 8;
+    payload[10] = result->framing_errors & 0xFF;
+    payload[11] = result->overruns >> 8;
+    payload[12] = result->overruns & 0xFF;
+    payload[13] = result->mismatches >> 8;
+    payload[14] = result->mismatches & 0xFF;
+
+    uart_uca0_send_frame(payload, 15);
+    self_test_reported++;
+}
+
 // INTERRUPTS ========================================================================
 #pragma vector = USCI_A0_VECTOR
 __interrupt void UART0_INTERRUPT(void)
 {
     switch(__even_in_range(UCA0IV, 4))
     {
-    default:
-        break;
+        case 4:
+            if (uca0_tx_tail == uca0_tx_head) {
+                // Fila vazia: desliga a interrupção até o próximo uart_uca0_send
+                UCA0IE &= ~UCTXIE;
+                break;
+            }
+
+            UCA0TXBUF = uca0_tx_buffer[uca0_tx_tail];
+            uca0_tx_tail = (uca0_tx_tail + 1) & UCA0_TX_BUFFER_MASK;
+            break;
+        default:
+            break;
     }
 }
 
@@ -186,31 +742,86 @@ __interrupt void UART1_INTERRUPT(void)
     switch(__even_in_range(UCA1IV, 4))
     {
         case 2:
-            bytes_received[bytes_received[0] + 1] = UCA1RXBUF;
-            if (++bytes_received[0] == 3)
-            {
-                if (bytes_received[1] == 0x11 &&
-                    bytes_received[2] == 0x22 &&
-                    bytes_received[3] == 0x33) {
-                    RED_LED_ON;
-                } else if (bytes_received[1] == 0xAA &&
-                    bytes_received[2] == 0xBB &&
-                    bytes_received[3] == 0xCC) {
-                    GREEN_LED_ON;
+            uca1_rx_wakeups++;
+            uca1_rx_bytes++;
+            uart_frame_receive_byte(UCA1RXBUF);
+            break;
+        default:
+            break;
+    }
+}
+
+#pragma vector = DMA_VECTOR
+__interrupt void DMA_INTERRUPT(void)
+{
+    switch(__even_in_range(DMAIV, 16))
+    {
+        case DMAIV_DMA0IFG:
+        {
+            volatile UartFrame* frame = &rx_frames[rx_frame_filling];
+            uca1_rx_wakeups++;
+
+            if (rx_dma_stage == DMA_RX_BODY) {
+                TA1CTL = TASSEL__SMCLK | ID__8 | MC_0 | TACLR;
+                TA1CCTL0 = 0;
+                uca1_rx_bytes += frame->length + 4;
+
+                uint16_t crc = crc16_step(0xFFFF, frame->length);
+                crc = crc16_block(crc, frame->payload, frame->length);
+                uint16_t received_crc = ((uint16_t) frame->payload[frame->length] << 8) |
+                                        frame->payload[frame->length + 1];
+
+                uart_frame_complete(frame, received_crc, crc);
+                rx_dma_arm(&rx_frames[rx_frame_filling].sync, 2, DMA_RX_HEADER);
+                break;
+            }
+
+            if (rx_dma_stage == DMA_RX_HEADER && frame->sync != FRAME_SYNC) {
+                if (frame->length == FRAME_SYNC) {
+                    // Desalinhado por um byte: o SYNC veio no lugar do LEN
+                    frame->sync = FRAME_SYNC;
+                    rx_dma_arm(&frame->length, 1, DMA_RX_LENGTH);
                 } else {
-                    RED_LED_OFF;
-                    GREEN_LED_OFF;
+                    rx_dma_arm(&frame->sync, 2, DMA_RX_HEADER);
                 }
+                break;
+            }
 
-                bytes_received[0] = 0;
+            if (frame->length > FRAME_MAX_PAYLOAD) {
+                if (frame->length == FRAME_SYNC) {
+                    rx_dma_arm(&frame->length, 1, DMA_RX_LENGTH);
+                } else {
+                    rx_dma_arm(&frame->sync, 2, DMA_RX_HEADER);
+                }
+                break;
             }
 
+            // Cabeçalho válido: estágio 2, payload + CRC de uma vez com prazo para o quadro
+            rx_dma_arm(frame->payload, frame->length + 2, DMA_RX_BODY);
+            TA1CCR0 = (frame->length + 2 + UART_DEADLINE_SLACK_CHARS) * UART_CHAR_TICKS;
+            TA1CCTL0 = CCIE;
+            TA1CTL = TASSEL__SMCLK | ID__8 | MC_1 | TACLR;
             break;
+        }
         default:
             break;
     }
 }
 
+#pragma vector = TIMER1_A0_VECTOR
+__interrupt void UART_FRAME_DEADLINE_INTERRUPT(void)
+{
+    // O corpo não chegou inteiro dentro do prazo: descarta e volta a procurar o cabeçalho
+    TA1CTL = TASSEL__SMCLK | ID__8 | MC_0 | TACLR;
+    TA1CCTL0 = 0;
+    uca1_rx_wakeups++;
+    rx_frames_truncated++;
+    rx_dma_arm(&rx_frames[rx_frame_filling].sync, 2, DMA_RX_HEADER);
+}
+
+const uint8_t green_payload[3] = { 0xAA, 0xBB, 0xCC };
+const uint8_t red_payload[3] = { 0x11, 0x22, 0x33 };
+
 #pragma vector = PORT1_VECTOR;
 __interrupt void __p1_interrupt_handle(void)
 {
@@ -222,9 +833,7 @@ __interrupt void __p1_interrupt_handle(void)
                 return;
             }
 
-            send_byte_uca0_sync(0xAA);
-            send_byte_uca0_sync(0xBB);
-            send_byte_uca0_sync(0xCC);
+            uart_uca0_send_frame(green_payload, 3);
             DEBOUNCE;
             break;
         default:
@@ -245,9 +854,7 @@ __interrupt void __p2_interrupt_handle(void)
                 return;
             }
 
-            send_byte_uca0_sync(0x11);
-            send_byte_uca0_sync(0x22);
-            send_byte_uca0_sync(0x33);
+            uart_uca0_send_frame(red_payload, 3);
             DEBOUNCE;
             break;
         default:
@@ -256,69 +863,3 @@ __interrupt void __p2_interrupt_handle(void)
 
     P2IFG = 0;
 }
-
-// CÓDIGO NÃO MODIFICADO =============================================================
-void pmmVCore (unsigned int level)
-{
-#if defined (__MSP430F5529__)
-    PMMCTL0_H = 0xA5;                       // Open PMM registers for write access
-
-    SVSMHCTL =                              // Set SVS/SVM high side new level
-            SVSHE            +
-            SVSHRVL0 * level +
-            SVMHE            +
-            SVSMHRRL0 * level;
-
-    SVSMLCTL =                              // Set SVM low side to new level
-            SVSLE            +
-//          SVSLRVL0 * level +              // but not SVS, not yet..
-            SVMLE            +
-            SVSMLRRL0 * level;
-
-    while ((PMMIFG & SVSMLDLYIFG) == 0);    // Wait till SVM is settled
-
-    PMMIFG &= ~(SVMLVLRIFG + SVMLIFG);      // Clear already set flags
-
-    PMMCTL0_L = PMMCOREV0 * level;          // Set VCore to new level
-
-    if ((PMMIFG & SVMLIFG))                 // Wait till new level reached
-        while ((PMMIFG & SVMLVLRIFG) == 0);
-
-    SVSMLCTL =                              // Set SVS/SVM low side to new level
-            SVSLE            +
-            SVSLRVL0 * level +
-            SVMLE            +
-            SVSMLRRL0 * level;
-
-    PMMCTL0_H = 0x00;                       // Lock PMM registers for write access
-#endif
-}
-
-void clockInit()
-{
-    pmmVCore(1);
-    pmmVCore(2);
-    pmmVCore(3);
-
-    P5SEL |= BIT2 | BIT3 | BIT4 | BIT5;
-    UCSCTL0 = 0x00;
-    UCSCTL1 = DCORSEL_5;
-    UCSCTL2 = FLLD__1 | FLLN(25);
-    UCSCTL3 = SELREF__XT2CLK | FLLREFDIV__4;
-    UCSCTL6 = XT2DRIVE_2 | XT1DRIVE_2 | XCAP_3;
-    UCSCTL7 = 0;                            // Clear XT2,XT1,DCO fault flags
-
-    do {                                    // Check if all clocks are oscillating
-      UCSCTL7 &= ~(   XT2OFFG |             // Try to clear XT2,XT1,DCO fault flags,
-                    XT1LFOFFG |             // system fault flags and check if
-                       DCOFFG );            // oscillators are still faulty
-      SFRIFG1 &= ~OFIFG;                    //
-    } while (SFRIFG1 & OFIFG);              // Exit only when everything is ok
-
-    UCSCTL5 = DIVPA_1 | DIVA_0 | DIVM_0; //Divide ACLK por 2.
-
-    UCSCTL4 = SELA__XT1CLK    |             // ACLK  = XT1   =>      16.384 Hz
-              SELS__XT2CLK    |             // SMCLK = XT2   =>   4.000.000 Hz
-              SELM__DCOCLK;                 // MCLK  = DCO   =>  25.000.000 Hz
-
-}
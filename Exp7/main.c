@@ -1,8 +1,13 @@
 #include <msp430.h>
 #include <inttypes.h>
 
-#define to_high_nibble(b) ((b & 0xf) << 4)
-#define to_low_nibble(b) ((b & 0xf))
+// Árvore de clocks padrão após o reset (sem clockInit)
+#define ACLK_HZ 32768UL
+#define SMCLK_HZ 1048576UL
+#include "../Common/clocks.h"
+
+#define LCD_I2C_SCL_HZ 100000UL // Máximo do PCF8574
+CLOCK_STATIC_ASSERT(I2C_BR(SMCLK_HZ, LCD_I2C_SCL_HZ) >= 4, lcd_i2c_scl_too_fast);
 
 typedef uint8_t bool;
 const bool true = 1;
@@ -10,32 +15,10 @@ const bool false = 0;
 
 typedef uint8_t byte;
 
-typedef struct {
-    bool backlight_on;
-    byte address;
-    byte buffer[2][16];
-} LCD;
-
-#define LCD_I2C_ADDRESS 0x27
-#define LCD_ENABLE_BIT BIT2
-#define LCD_BACKLIGHT_BIT BIT3
-#define LCD_SET_DDRAM_ADDRESS_BIT BIT7
-
-// Low level LCD
-LCD initialize_lcd(byte address);
-byte assemble_byte_from_lcd_nibble(LCD* lcd, byte nibble, bool is_instruction);
-void lcd_send_raw_byte(LCD* lcd, byte b);
-void lcd_send_nibble(LCD* lcd, byte nibble, bool is_instruction);
-void lcd_send_byte(LCD* lcd, byte b, bool is_instruction);
-
-// High level LCD
-void lcd_set_cursor_position(LCD* lcd, byte row, byte col);
-void lcd_write_char(LCD* lcd, byte c);
-void lcd_clear(LCD* lcd);
-
-// LCD Buffer
-#define LCD_EMPTY_CHAR (0x20)
-void lcd_flush(LCD* lcd);
+void delay_us(unsigned int time_us);
+
+// LCD 16x2 no PCF8574 (Common/lcd.h). O driver usa o UCB0 e o TB0
+#include "../Common/lcd.h"
 
 // - Esse código transmite 0x00 / 0xFF para o LCD/
 // - UCB0 é configurado como MASTER TRANSMITTER
@@ -53,8 +36,25 @@ void lcd_flush(LCD* lcd);
 #define LED_GREEN_OFF     (P4OUT &= ~BIT7)
 
 void initialize_I2C_UCB0_MasterTransmitter();
-void master_TransmitOneByte(unsigned char address, unsigned char data);
-void delay_us(unsigned int time_us);
+
+// Medida da banda do LCD: tempo de um redesenho completo (32 caracteres + 2 cursores)
+volatile unsigned int lcd_full_flush_ticks = 0;     // Ticks de ACLK
+volatile unsigned int lcd_chars_per_second = 0;
+volatile unsigned int lcd_init_ticks = 0;          // initialize_lcd até a fila esvaziar
+volatile unsigned int lcd_clear_ticks = 0;         // lcd_clear até a fila esvaziar
+void lcd_measure_bandwidth(LCD* lcd);
+
+// Vários displays no mesmo UCB0: backpacks em LCD_I2C_ADDRESS, LCD_I2C_ADDRESS - 1, ...
+// (0x27..0x20). Um endereço sem backpack dá NACK e a ISR descarta seus ops, então ele sai
+// quase de graça do tempo medido: a banda somada só conta os displays que responderam.
+// Os valores são o que o TA1 contou nesta placa, com os displays que ela tiver; não há
+// números de referência aqui (o custo esperado por op está em Tests/lcd_test.c).
+#define LCD_BENCH_DISPLAYS 8
+LCD lcds[LCD_BENCH_DISPLAYS];
+volatile unsigned int lcd_multi_flush_ticks[4];         // 1, 2, 4 e 8 endereços
+volatile unsigned int lcd_multi_present[4];             // Quantos deles responderam (ACK)
+volatile unsigned int lcd_multi_chars_per_second[4];    // Soma dos displays presentes
+void lcd_measure_multi(LCD* displays);
 
 int main(void)
 {
@@ -75,24 +75,51 @@ int main(void)
     LED_RED_OFF;
     LED_GREEN_OFF;
 
-    LCD lcd = initialize_lcd(LCD_I2C_ADDRESS);
-
-    // Write 'R'
-    lcd.buffer[0][0] = 'B';
-    lcd.buffer[0][2] = 'A';
-    lcd.buffer[0][4] = 'T';
-    lcd.buffer[0][6] = 'A';
-    lcd.buffer[0][8] = 'T';
-    lcd.buffer[0][10] = 'A';
-
-    lcd.buffer[1][1] = 'B';
-    lcd.buffer[1][3] = 'A';
-    lcd.buffer[1][5] = 'T';
-    lcd.buffer[1][7] = 'A';
-    lcd.buffer[1][9] = 'T';
-    lcd.buffer[1][11] = 'A';
+    // A fila do LCD é drenada pelas interrupções do UCB0 e do TB0
+    __enable_interrupt();
+
+    TA1CTL = TASSEL__ACLK | MC__CONTINUOUS | TACLR;
+    lcds[0] = initialize_lcd(LCD_I2C_ADDRESS);
+    LCD* lcd = &lcds[0];
+    lcd_wait_idle();
+    lcd_init_ticks = TA1R;
+
+    TA1CTL = TASSEL__ACLK | MC__CONTINUOUS | TACLR;
+    lcd_clear(lcd);
+    lcd_wait_idle();
+    lcd_clear_ticks = TA1R;
+    TA1CTL = MC_0 | TACLR;
+
+    lcd->buffer[0][0] = 'B';
+    lcd->buffer[0][2] = 'A';
+    lcd->buffer[0][4] = 'T';
+    lcd->buffer[0][6] = 'A';
+    lcd->buffer[0][8] = 'T';
+    lcd->buffer[0][10] = 'A';
+
+    lcd->buffer[1][1] = 'B';
+    lcd->buffer[1][3] = 'A';
+    lcd->buffer[1][5] = 'T';
+    lcd->buffer[1][7] = 'A';
+    lcd->buffer[1][9] = 'T';
+    lcd->buffer[1][11] = 'A';
+
+    lcd_measure_bandwidth(lcd);
+
+    // Os outros displays mostram o mesmo texto. Os nibbles iniciais de initialize_lcd são
+    // síncronos: a fila do display anterior tem que terminar antes
+    volatile int i, row, col;
+    for (i = 1; i < LCD_BENCH_DISPLAYS; i++) {
+        lcd_wait_idle();
+        lcds[i] = initialize_lcd(LCD_I2C_ADDRESS - i);
+        for (row = 0; row < LCD_ROWS; row++) {
+            for (col = 0; col < LCD_COLS; col++) {
+                lcds[i].buffer[row][col] = lcd->buffer[row][col];
+            }
+        }
+    }
 
-    lcd_flush(&lcd);
+    lcd_measure_multi(lcds);
 
     while(1);
     return 0;
@@ -123,8 +150,8 @@ void initialize_I2C_UCB0_MasterTransmitter()
                 UCSWRST ;             //Mantém o módulo desligado
 
     //Divisor de clock para o BAUDRate
-    UCB0BR0 = 2;
-    UCB0BR1 = 0;
+    UCB0BR0 = I2C_BR0(SMCLK_HZ, LCD_I2C_SCL_HZ);
+    UCB0BR1 = I2C_BR1(SMCLK_HZ, LCD_I2C_SCL_HZ);
 
     //Liga o módulo.
     UCB0CTL1 &= ~UCSWRST;
@@ -132,126 +159,64 @@ void initialize_I2C_UCB0_MasterTransmitter()
     //Se eu quisesse ligar interrupções eu iria fazer isso aqui, depois de re-ligar o módulo..
 }
 
-LCD initialize_lcd(byte address)
+/*
+ * Cronometra lcd_invalidate + lcd_flush até a fila esvaziar, com o TA1 em ACLK (contínuo).
+ * Resultado fica em lcd_full_flush_ticks / lcd_chars_per_second para ler no debugger.
+ */
+void lcd_measure_bandwidth(LCD* lcd)
 {
-    LCD lcd;
-    lcd.address = LCD_I2C_ADDRESS;
-    lcd.backlight_on = true;
-
-    lcd_send_nibble(&lcd, 0x03, true);
-    lcd_send_nibble(&lcd, 0x03, true);
-    lcd_send_nibble(&lcd, 0x03, true);
-    lcd_send_nibble(&lcd, 0x02, true);
-
-    lcd_send_byte(&lcd, 0x28, true);
-    lcd_send_byte(&lcd, 0x08, true);
-    lcd_clear(&lcd);
-    lcd_send_byte(&lcd, 0x06, true);
-    lcd_send_byte(&lcd, 0x0F, true);
-
-    return lcd;
-}
+    lcd_wait_idle();
+    TA1CTL = TASSEL__ACLK | MC__CONTINUOUS | TACLR;
 
-byte assemble_byte_from_lcd_nibble(LCD* lcd, byte nibble, bool is_instruction)
-{
-    volatile byte result = is_instruction? 0x00 : 0x01;
-    result |= to_high_nibble(nibble);
-    result |= lcd->backlight_on? LCD_BACKLIGHT_BIT : 0;
-    return result;
-}
+    lcd_invalidate(lcd);
+    lcd_flush(lcd);
+    lcd_wait_idle();
 
-void lcd_send_nibble(LCD* lcd, byte nibble, bool is_instruction)
-{
-    volatile byte byte_to_send = assemble_byte_from_lcd_nibble(lcd, nibble, is_instruction);
-    lcd_send_raw_byte(lcd, byte_to_send);
-}
+    lcd_full_flush_ticks = TA1R;
+    TA1CTL = MC_0 | TACLR;
 
-void lcd_send_byte(LCD* lcd, byte b, bool is_instruction)
-{
-    lcd_send_nibble(lcd, (b >> 4) & 0xf, is_instruction);
-    lcd_send_nibble(lcd, b & 0xf,      is_instruction);
-}
-
-void lcd_send_raw_byte(LCD* lcd, byte b)
-{
-    master_TransmitOneByte(lcd->address, b);
-    delay_us(1000);
-    master_TransmitOneByte(lcd->address, b | LCD_ENABLE_BIT);
-    delay_us(2000);
-    master_TransmitOneByte(lcd->address, b);
-    delay_us(1000);
+    if (lcd_full_flush_ticks > 0) {
+        lcd_chars_per_second = (unsigned int)((unsigned long)LCD_ROWS * LCD_COLS * ACLK_HZ / lcd_full_flush_ticks);
+    }
 }
 
-void lcd_set_cursor_position(LCD* lcd, byte row, byte col)
+/*
+ * Redesenho completo de 1, 2, 4 e 8 endereços de uma vez (todos enfileirados, a fila intercala
+ * no barramento). Antes de cronometrar, cada endereço recebe um byte sem pulso de E (só o
+ * backlight, o HD44780 não vê nada) para saber se há backpack; lcd_multi_chars_per_second é a
+ * banda somada só dos presentes.
+ */
+void lcd_measure_multi(LCD* displays)
 {
-    lcd_send_byte(lcd, (row * 0x40 + col) | LCD_SET_DDRAM_ADDRESS_BIT, true);
-}
+    const byte idle = LCD_BACKLIGHT_BIT;
+    byte k, i, n, present;
+    unsigned int ticks;
 
-void lcd_write_char(LCD* lcd, byte c)
-{
-    lcd_send_byte(lcd, c, false);
-}
+    for (k = 0; k < 4; k++) {
+        n = 1 << k;
 
-void lcd_clear(LCD* lcd)
-{
-    volatile int i, j;
-    for (i = 0; i < 2; i++) {
-        for (j = 0; j < 16; j++) {
-            lcd->buffer[i][j] = LCD_EMPTY_CHAR;
+        present = 0;
+        for (i = 0; i < n && i < LCD_BENCH_DISPLAYS; i++) {
+            present += master_TransmitBytes(displays[i].address, &idle, 1)? 1 : 0;
         }
-    }
+        lcd_multi_present[k] = present;
 
-    lcd_send_byte(lcd, 0x1, true);
-}
+        lcd_wait_idle();
+        TA1CTL = TASSEL__ACLK | MC__CONTINUOUS | TACLR;
 
-void lcd_flush(LCD* lcd)
-{
-    volatile int i, j;
-    for (i = 0; i < 2; i++) {
-        for (j = 0; j < 16; j++) {
-            lcd_set_cursor_position(lcd, i, j);
-            lcd_write_char(lcd, lcd->buffer[i][j]);
+        for (i = 0; i < n && i < LCD_BENCH_DISPLAYS; i++) {
+            lcd_invalidate(&displays[i]);
+            lcd_flush(&displays[i]);
         }
-    }
-}
+        lcd_wait_idle();
 
-void master_TransmitOneByte(unsigned char address, unsigned char data)
-{
-    //Desligo todas as interrupções
-    UCB0IE = 0;
-
-    //Coloco o slave address
-    UCB0I2CSA = address;
-
-    //Espero a linha estar desocupada.
-    if (UCB0STAT & UCBBUSY) return;
-
-    //Peço um START
-    UCB0CTL1 |= UCTXSTT;
-
-    //Espero até o buffer de transmissão estar disponível
-    while ((UCB0IFG & UCTXIFG) == 0);
-
-    //Escrevo o dado
-    UCB0TXBUF = data;
-
-    //Aguardo o acknowledge
-    while (UCB0CTL1 & UCTXSTT);
-
-    //Verifico se é um ACK ou um NACK
-    if ((UCB0IFG & UCNACKIFG) != 0)
-    {
-        //Peço uma condição de parada
-        LED_RED_ON;
-        UCB0CTL1 |= UCTXSTP;
-    } else
-    {
-        //Peço uma condição de parada
-        LED_GREEN_ON;
-        UCB0CTL1 |= UCTXSTP;
-    }
+        ticks = TA1R;
+        TA1CTL = MC_0 | TACLR;
 
-    return;
+        lcd_multi_flush_ticks[k] = ticks;
+        lcd_multi_chars_per_second[k] = ticks > 0?
+            (unsigned int)((unsigned long)present * LCD_ROWS * LCD_COLS * ACLK_HZ / ticks) : 0;
+    }
 }
 
 /*
@@ -1,5 +1,10 @@
 #include <msp430.h> 
 
+// Árvore de clocks padrão após o reset (sem clockInit)
+#define ACLK_HZ 32768UL
+#define SMCLK_HZ 1048576UL
+#include "../Common/clocks.h"
+
 int diff;
 
 #define RED_LED_ON P1OUT |= BIT0
@@ -39,7 +44,7 @@ void configure_adc_trigger_clk()
     TA0CTL = TASSEL__ACLK | MC_1;
     TA0CCTL1 = OUTMOD_6;
 
-    TA0CCR0 = 3276; // ACLK / 10 ~ 10Hz
+    TA0CCR0 = TIMER_CCR0(ACLK_HZ, 1, 10); // ACLK / 10 ~ 10Hz
     TA0CCR1 = TA0CCR0 >> 1; // 50% duty cycle
 }
 
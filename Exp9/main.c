@@ -1,6 +1,23 @@
 #include <msp430.h> 
 
-volatile unsigned int measurements[4];
+// Árvore de clocks padrão após o reset (sem clockInit)
+#define ACLK_HZ 32768UL
+#define SMCLK_HZ 1048576UL
+#include "../Common/clocks.h"
+#include "../Common/adc_snapshot.h"
+
+// Aquisição por DMA (Common/adc_dma.h): a CPU acorda uma vez por bloco de sequências.
+// Com o disparo a 4 Hz cada sequência leva 4 s, então o bloco aqui é de 2 sequências.
+#ifndef ADC_USE_DMA
+#define ADC_USE_DMA 1
+#endif
+#if ADC_USE_DMA
+#define ADC_DMA_BLOCK_SHIFT 1
+#include "../Common/adc_dma.h"
+#endif
+
+AdcSnapshot adc_snapshot;     // Publicado pela ISR a cada sequência
+unsigned int measurements[4]; // Cópia consistente para o laço principal
 
 #define RED_LED_ON P1OUT |= BIT0
 #define RED_LED_OFF P1OUT &= ~BIT0
@@ -18,11 +35,31 @@ int main(void)
 
     configure_leds();
     configure_adc_trigger_clk();
+#if ADC_USE_DMA
+    adc_dma_start();
+#endif
     configure_adc();
 
     __enable_interrupt();
 
-    while(1);
+#if ADC_USE_DMA
+    while(1) {
+        // Dorme até o DMA fechar um bloco; a média sai direto no laço, sem concorrência com ISR
+        __disable_interrupt();
+        while (!adc_dma_block_ready()) {
+            __bis_SR_register(LPM0_bits | GIE);
+            __disable_interrupt();
+        }
+        __enable_interrupt();
+
+        adc_dma_average(measurements);
+    }
+#else
+    while(1) {
+        // Os 4 canais sempre da mesma sequência, sem desligar as interrupções
+        adc_snapshot_read(&adc_snapshot, measurements);
+    }
+#endif
 }
 
 void configure_leds()
@@ -39,7 +76,7 @@ void configure_adc_trigger_clk()
     TA0CTL = TASSEL__ACLK | MC_1;
     TA0CCTL1 = OUTMOD_6;
 
-    TA0CCR0 = 8192; // ACLK / 4 ~ 4Hz
+    TA0CCR0 = TIMER_CCR0(ACLK_HZ, 1, 4); // ACLK / 4 ~ 4Hz
     TA0CCR1 = TA0CCR0 >> 1; // 50% duty cycle
 }
 
@@ -103,8 +140,13 @@ void configure_adc()
     ADC12MCTL14 = ADC12SREF_0 | ADC12INCH_3;
     ADC12MCTL15 = ADC12SREF_0 | ADC12INCH_3 | ADC12EOS;
 
+#if ADC_USE_DMA
+    // Quem lê as MEMx é o DMA, no fim de cada sequência
+    ADC12IE = 0;
+#else
     // Habilita interrupção na última conversão
     ADC12IE = ADC12IE15;
+#endif
 
     // Habilita o módulo ADC após configurações
     ADC12CTL0 |= ADC12ENC;
@@ -114,6 +156,8 @@ void configure_adc()
 #pragma vector = ADC12_VECTOR
 __interrupt void __adc12_interrupt(void)
 {
+    unsigned int sample[4];
+
     switch(__even_in_range(ADC12IV,0x24)) {
         case ADC12IV_NONE:
             break;
@@ -125,10 +169,11 @@ __interrupt void __adc12_interrupt(void)
             // ADC12MEM15 preenchida
 
             // Ler valores preenchidos
-            measurements[0] = (ADC12MEM0 + ADC12MEM1 + ADC12MEM2 + ADC12MEM3) >> 2;
-            measurements[1] = (ADC12MEM4 + ADC12MEM5 + ADC12MEM6 + ADC12MEM7) >> 2;
-            measurements[2] = (ADC12MEM8 + ADC12MEM9 + ADC12MEM10 + ADC12MEM11) >> 2;
-            measurements[3] = (ADC12MEM12 + ADC12MEM13 + ADC12MEM14 + ADC12MEM15) >> 2;
+            sample[0] = (ADC12MEM0 + ADC12MEM1 + ADC12MEM2 + ADC12MEM3) >> 2;
+            sample[1] = (ADC12MEM4 + ADC12MEM5 + ADC12MEM6 + ADC12MEM7) >> 2;
+            sample[2] = (ADC12MEM8 + ADC12MEM9 + ADC12MEM10 + ADC12MEM11) >> 2;
+            sample[3] = (ADC12MEM12 + ADC12MEM13 + ADC12MEM14 + ADC12MEM15) >> 2;
+            adc_snapshot_publish(&adc_snapshot, sample);
             break;
         default:
             // Fazer nada
@@ -0,0 +1,70 @@
+/*
+ * adc_snapshot_test.c
+ *
+ * Teste no PC de Common/adc_snapshot.h: um SIGALRM faz o papel da ISR do ADC e publica um
+ * conjunto novo a cada ~20 us, no meio das cópias do laço principal. Cada conjunto tem os
+ * canais ligados entre si (v[i] = 4 * n + i); uma cópia com canais de conjuntos diferentes
+ * é uma cópia rasgada.
+ *
+ * Como na placa, o escritor interrompe o leitor e nunca o contrário. O teste falha se
+ * alguma cópia sair rasgada ou se nenhuma publicação cair no meio de uma cópia (retries = 0:
+ * o teste não exercitou o caminho de repetição).
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <sys/time.h>
+
+#include "../Common/adc_snapshot.h"
+
+#define TEST_PUBLICATIONS 20000
+
+AdcSnapshot snapshot;
+volatile unsigned int publications = 0;
+
+void publish_handler(int signal)
+{
+    unsigned int values[ADC_SNAPSHOT_CHANNELS];
+    unsigned int i;
+
+    publications++;
+    for (i = 0; i < ADC_SNAPSHOT_CHANNELS; i++) {
+        values[i] = publications * ADC_SNAPSHOT_CHANNELS + i;
+    }
+    adc_snapshot_publish(&snapshot, values);
+}
+
+int main()
+{
+    struct itimerval period = { { 0, 20 }, { 0, 20 } };
+    unsigned int values[ADC_SNAPSHOT_CHANNELS];
+    unsigned long reads = 0, torn = 0;
+    unsigned int i;
+
+    signal(SIGALRM, publish_handler);
+    setitimer(ITIMER_REAL, &period, 0);
+
+    while (publications < TEST_PUBLICATIONS) {
+        adc_snapshot_read(&snapshot, values);
+        reads++;
+        for (i = 1; i < ADC_SNAPSHOT_CHANNELS; i++) {
+            if (values[0] && values[i] != values[0] + i) {
+                torn++;
+                break;
+            }
+        }
+    }
+
+    period.it_value.tv_usec = 0;
+    period.it_interval.tv_usec = 0;
+    setitimer(ITIMER_REAL, &period, 0);
+
+    printf("%u publicações, %lu cópias, %lu rasgadas, %u refeitas\n",
+           publications, reads, torn, adc_snapshot_retries);
+    if (torn || adc_snapshot_retries == 0) {
+        printf("FALHA\n");
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
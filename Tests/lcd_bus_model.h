@@ -0,0 +1,534 @@
+/*
+ * lcd_bus_model.h
+ *
+ * Modelo no PC do que está atrás do driver de Common/lcd.h: o UCB0 como mestre I2C, o timer
+ * de espera (TB0), as interrupções/LPM0 e, no barramento, backpacks PCF8574 com um HD44780.
+ *
+ * O tempo é simulado (mock_time_ns). O barramento anda por eventos: START + endereço leva
+ * 10 bits de SCL, cada byte 9 e o STOP 1, e o USCI só começa o próximo quando o anterior
+ * terminou. A CPU custa MOCK_ACCESS_NS por acesso a registrador e nada fora deles, então o
+ * main enche a fila bem antes do barramento drenar, como na placa. O HD44780 guarda a
+ * DDRAM/CGRAM, o contador de endereço e o deslocamento do display, responde o busy flag
+ * pelo tempo de execução de cada instrução e conta as que chegaram ainda ocupado.
+ *
+ * As interrupções são entregues onde o main pode ser interrompido de forma visível:
+ * __enable_interrupt, __set_interrupt_state com GIE, delay_us e o LPM0. Um LPM0 sem
+ * interrupção pendente, evento no barramento nem timer armado é um travamento do driver e
+ * encerra o teste.
+ *
+ * Incluir depois de lcd.h (chama __ucb0_lcd_interrupt e __lcd_wait_timer_handle).
+ */
+
+#ifndef LCD_BUS_MODEL_H_
+#define LCD_BUS_MODEL_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MOCK_TXBUF_EMPTY 0xFFFF
+#define MOCK_ACCESS_NS 1000ULL
+#define MOCK_MAX_DEVICES 8
+#define MOCK_BIT_NS (1000000000ULL / I2C_ACHIEVED_SCL(SMCLK_HZ, LCD_I2C_SCL_HZ))
+#define MOCK_ACLK_NS (1000000000ULL / ACLK_HZ)
+
+// Tempos do HD44780 (datasheet, fosc = 270 kHz)
+#define MOCK_HD44780_POWER_ON_NS 40000000ULL
+#define MOCK_HD44780_COMMAND_NS 37000ULL
+#define MOCK_HD44780_CLEAR_HOME_NS 1520000ULL
+
+typedef struct {
+    byte address;
+    bool present;
+    byte out;                   // Último byte escrito no PCF8574
+
+    // HD44780
+    bool four_bit;
+    bool second_nibble;         // Próximo E (modo 4 bits) é o nibble baixo
+    byte first_nibble;
+    bool two_lines;
+    bool display_on;
+    bool increment;
+    bool entry_shift;
+    bool address_cgram;
+    byte ac;
+    int window;                 // Deslocamento do display (coluna da DDRAM na borda esquerda)
+    byte ddram[80];
+    byte cgram[64];
+    unsigned long long busy_until_ns;
+    unsigned int instructions;
+    unsigned int busy_violations;
+} MockLcd;
+
+typedef enum {
+    MOCK_BUS_IDLE,
+    MOCK_BUS_TX,
+    MOCK_BUS_RX,
+    MOCK_BUS_NACKED     // Endereço sem resposta, esperando o STOP
+} MockBusState;
+
+// O que está saindo no barramento agora; termina em mock_bus_due_ns
+typedef enum {
+    MOCK_EVENT_NONE,
+    MOCK_EVENT_ADDRESS,     // START + endereço + ACK/NACK
+    MOCK_EVENT_TX_BYTE,
+    MOCK_EVENT_RX_BYTE,
+    MOCK_EVENT_STOP
+} MockBusEvent;
+
+typedef struct {
+    unsigned long transactions;     // STARTs, incluindo repeated START
+    unsigned long bytes;            // Bytes de dados escritos e lidos (sem o endereço)
+    unsigned long nacks;
+} MockBusStats;
+
+MockUcb0 mock_ucb0 = { 0, 0, 0, 0, MOCK_TXBUF_EMPTY };
+MockTimer mock_tb0;
+MockLcd mock_lcds[MOCK_MAX_DEVICES];
+unsigned int mock_lcd_count = 0;
+MockBusStats mock_bus;
+unsigned long long mock_time_ns = 0;
+
+MockBusState mock_bus_state = MOCK_BUS_IDLE;
+MockLcd* mock_bus_device = 0;
+MockBusEvent mock_bus_event = MOCK_EVENT_NONE;
+unsigned long long mock_bus_due_ns = 0;
+byte mock_tx_shift = 0;
+byte mock_rxbuf = 0;
+unsigned long long mock_timer_start_ns = 0;
+bool mock_gie = false;
+bool mock_in_isr = false;
+bool mock_wake = false;
+bool mock_trace = false;    // Eventos do barramento em stderr (lcd_test -v)
+
+// HD44780 =============================================================================
+MockLcd* mock_lcd_add(byte address, bool present)
+{
+    MockLcd* lcd = &mock_lcds[mock_lcd_count++];
+    memset(lcd, 0, sizeof(*lcd));
+    lcd->address = address;
+    lcd->present = present;
+    lcd->increment = true;
+    lcd->busy_until_ns = MOCK_HD44780_POWER_ON_NS;
+    memset(lcd->ddram, ' ', sizeof(lcd->ddram));
+    return lcd;
+}
+
+MockLcd* mock_lcd_find(byte address)
+{
+    unsigned int i;
+    for (i = 0; i < mock_lcd_count; i++) {
+        if (mock_lcds[i].address == address) return &mock_lcds[i];
+    }
+    return 0;
+}
+
+int mock_lcd_ddram_index(MockLcd* lcd, byte address)
+{
+    if (!lcd->two_lines) return address % 80;
+    return ((address & 0x40)? 40 : 0) + (address & 0x3F) % 40;
+}
+
+void mock_lcd_step_address(MockLcd* lcd)
+{
+    if (lcd->address_cgram) {
+        lcd->ac = (lcd->ac + (lcd->increment? 1 : -1)) & 0x3F;
+        return;
+    }
+    if (!lcd->two_lines) {
+        lcd->ac = (lcd->ac + (lcd->increment? 1 : 79)) % 80;
+        return;
+    }
+    // Em 2 linhas, 0x27 continua em 0x40 e 0x67 em 0x00
+    if (lcd->increment) {
+        lcd->ac = (lcd->ac == 0x27)? 0x40 : (lcd->ac == 0x67)? 0x00 : lcd->ac + 1;
+    } else {
+        lcd->ac = (lcd->ac == 0x40)? 0x27 : (lcd->ac == 0x00)? 0x67 : lcd->ac - 1;
+    }
+}
+
+void mock_lcd_execute(MockLcd* lcd, byte value, bool data, unsigned long long at)
+{
+    unsigned long long duration = MOCK_HD44780_COMMAND_NS;
+
+    if (at < lcd->busy_until_ns) {
+        lcd->busy_violations++;
+    }
+    lcd->instructions++;
+
+    if (data) {
+        if (lcd->address_cgram) {
+            lcd->cgram[lcd->ac & 0x3F] = value;
+        } else {
+            lcd->ddram[mock_lcd_ddram_index(lcd, lcd->ac)] = value;
+            if (lcd->entry_shift) lcd->window += lcd->increment? 1 : -1;
+        }
+        mock_lcd_step_address(lcd);
+    } else if (value & 0x80) {
+        lcd->address_cgram = false;
+        lcd->ac = value & 0x7F;
+    } else if (value & 0x40) {
+        lcd->address_cgram = true;
+        lcd->ac = value & 0x3F;
+    } else if (value & 0x20) {
+        lcd->four_bit = !(value & 0x10);
+        lcd->two_lines = (value & 0x08) != 0;
+        lcd->second_nibble = false;
+    } else if (value & 0x10) {
+        if (value & 0x08) {
+            lcd->window += (value & 0x04)? -1 : 1;
+        } else {
+            bool increment = lcd->increment;
+            lcd->increment = (value & 0x04) != 0;
+            mock_lcd_step_address(lcd);
+            lcd->increment = increment;
+        }
+    } else if (value & 0x08) {
+        lcd->display_on = (value & 0x04) != 0;
+    } else if (value & 0x04) {
+        lcd->increment = (value & 0x02) != 0;
+        lcd->entry_shift = (value & 0x01) != 0;
+    } else if (value & 0x02) {
+        lcd->address_cgram = false;
+        lcd->ac = 0;
+        lcd->window = 0;
+        duration = MOCK_HD44780_CLEAR_HOME_NS;
+    } else if (value & 0x01) {
+        memset(lcd->ddram, ' ', sizeof(lcd->ddram));
+        lcd->address_cgram = false;
+        lcd->ac = 0;
+        lcd->window = 0;
+        lcd->increment = true;
+        duration = MOCK_HD44780_CLEAR_HOME_NS;
+    }
+
+    lcd->busy_until_ns = at + duration;
+}
+
+/*
+ * Pinos do PCF8574 depois de uma escrita. A descida do E é quando o HD44780 usa o nibble.
+ */
+void mock_lcd_write_pins(MockLcd* lcd, byte value, unsigned long long at)
+{
+    bool falling = (lcd->out & LCD_ENABLE_BIT) && !(value & LCD_ENABLE_BIT);
+    byte nibble = (value >> LCD_DATA_SHIFT) & 0x0F;
+    bool rs = (value & LCD_RS_BIT) != 0;
+    lcd->out = value;
+
+    if (!falling) return;
+
+    if (value & LCD_RW_BIT) {
+        // Leitura: em 4 bits, cada par de pulsos é um byte (BF + AC)
+        if (lcd->four_bit) lcd->second_nibble = !lcd->second_nibble;
+        return;
+    }
+    if (!lcd->four_bit) {
+        mock_lcd_execute(lcd, nibble << 4, rs, at);
+    } else if (!lcd->second_nibble) {
+        lcd->first_nibble = nibble;
+        lcd->second_nibble = true;
+    } else {
+        lcd->second_nibble = false;
+        mock_lcd_execute(lcd, (lcd->first_nibble << 4) | nibble, rs, at);
+    }
+}
+
+/*
+ * Leitura do PCF8574: os pinos em 1 são entradas e mostram o que o HD44780 coloca em
+ * D7..D4 com RW = 1 e E = 1 (BF e AC6..4 no primeiro nibble, AC3..0 no segundo).
+ */
+byte mock_lcd_read_pins(MockLcd* lcd, unsigned long long at)
+{
+    byte value = lcd->out;
+    if ((lcd->out & LCD_RW_BIT) && (lcd->out & LCD_ENABLE_BIT)) {
+        byte busy = at < lcd->busy_until_ns;
+        byte data = (busy << 7) | (lcd->ac & 0x7F);
+        byte nibble = (lcd->four_bit && lcd->second_nibble)? (data & 0x0F) : (data >> 4);
+        value = (value & ~LCD_DATA_MASK) | ((nibble << LCD_DATA_SHIFT) & value);
+    }
+    return value;
+}
+
+/*
+ * O que aparece na linha row (LCD_COLS caracteres + '\0').
+ */
+void mock_lcd_row(MockLcd* lcd, byte row, char* text)
+{
+    byte col;
+    for (col = 0; col < LCD_COLS; col++) {
+        int offset = ((row & 2)? LCD_COLS : 0) + col + lcd->window;
+        int line = lcd->two_lines? 40 : 80;
+        offset = ((offset % line) + line) % line;
+        text[col] = lcd->ddram[((row & 1) && lcd->two_lines? 40 : 0) + offset];
+    }
+    text[LCD_COLS] = '\0';
+}
+
+// UCB0 e TB0 ==========================================================================
+void mock_bus_schedule(MockBusEvent event, unsigned long long at, unsigned int bits)
+{
+    mock_bus_event = event;
+    mock_bus_due_ns = at + bits * MOCK_BIT_NS;
+}
+
+/*
+ * Fim do evento em andamento, no instante at em que ele terminou.
+ */
+void mock_bus_complete(unsigned long long at)
+{
+    MockBusEvent event = mock_bus_event;
+    mock_bus_event = MOCK_EVENT_NONE;
+    if (mock_trace) {
+        fprintf(stderr, "%10.1f us  evento %d  CTL1 %02X  SA %02X  TX %02X\n",
+                at / 1e3, event, mock_ucb0.ctl1, mock_ucb0.i2csa, mock_tx_shift);
+    }
+
+    switch (event) {
+        case MOCK_EVENT_ADDRESS:
+            mock_ucb0.ctl1 &= ~UCTXSTT;
+            mock_bus.transactions++;
+            mock_bus_device = mock_lcd_find(mock_ucb0.i2csa);
+            if (!mock_bus_device || !mock_bus_device->present) {
+                mock_bus.nacks++;
+                mock_bus_state = MOCK_BUS_NACKED;
+                mock_ucb0.ifg |= UCNACKIFG;
+            } else if (mock_ucb0.ctl1 & UCTR) {
+                mock_bus_state = MOCK_BUS_TX;
+                mock_ucb0.ifg |= UCTXIFG;
+            } else {
+                mock_bus_state = MOCK_BUS_RX;
+                mock_bus_schedule(MOCK_EVENT_RX_BYTE, at, 9);
+            }
+            break;
+        case MOCK_EVENT_TX_BYTE:
+            mock_lcd_write_pins(mock_bus_device, mock_tx_shift, at);
+            mock_bus.bytes++;
+            mock_ucb0.ifg |= UCTXIFG;
+            break;
+        case MOCK_EVENT_RX_BYTE:
+            // Com o UCTXSTP já pedido, este foi o último byte (NACK do mestre) e o STOP segue;
+            // senão o próximo byte só começa quando o RXBUF for lido
+            mock_rxbuf = mock_lcd_read_pins(mock_bus_device, at);
+            mock_bus.bytes++;
+            mock_ucb0.ifg |= UCRXIFG;
+            if (mock_ucb0.ctl1 & UCTXSTP) {
+                mock_bus_schedule(MOCK_EVENT_STOP, at, 1);
+            }
+            break;
+        case MOCK_EVENT_STOP:
+            mock_ucb0.ctl1 &= ~UCTXSTP;
+            mock_ucb0.ifg &= ~UCTXIFG;
+            mock_bus_state = MOCK_BUS_IDLE;
+            mock_bus_device = 0;
+            break;
+        default:
+            break;
+    }
+}
+
+/*
+ * Avança o UCB0 e o timer até mock_time_ns, com o que o código escreveu desde o último acesso.
+ * O USCI só começa a próxima coisa (byte do TXBUF, START, STOP) quando a anterior terminou.
+ */
+void mock_settle()
+{
+    if (mock_tb0.ctl & TBCLR) {
+        mock_tb0.ctl &= ~TBCLR;
+        mock_timer_start_ns = mock_time_ns;
+    }
+
+    while (1) {
+        unsigned long long at = mock_time_ns;
+        if (mock_bus_event != MOCK_EVENT_NONE) {
+            if (mock_time_ns < mock_bus_due_ns) return;
+            at = mock_bus_due_ns;
+            mock_bus_complete(at);
+            if (mock_bus_event != MOCK_EVENT_NONE) continue;
+        }
+
+        if (mock_ucb0.txbuf != MOCK_TXBUF_EMPTY) {
+            if (mock_bus_state != MOCK_BUS_TX) {
+                fprintf(stderr, "UCB0TXBUF escrito fora de uma transmissão\n");
+                exit(1);
+            }
+            mock_tx_shift = mock_ucb0.txbuf;
+            mock_ucb0.txbuf = MOCK_TXBUF_EMPTY;
+            mock_ucb0.ifg &= ~UCTXIFG;     // Escrever no TXBUF limpa o TXIFG
+            mock_bus_schedule(MOCK_EVENT_TX_BYTE, at, 9);
+        } else if (mock_ucb0.ctl1 & UCTXSTT) {
+            if (mock_bus_state == MOCK_BUS_RX) {
+                fprintf(stderr, "START no meio de uma leitura\n");
+                exit(1);
+            }
+            mock_bus_schedule(MOCK_EVENT_ADDRESS, at, 10);
+        } else if ((mock_ucb0.ctl1 & UCTXSTP) && mock_bus_state != MOCK_BUS_RX) {
+            mock_bus_schedule(MOCK_EVENT_STOP, at, 1);
+        } else {
+            return;
+        }
+    }
+}
+
+volatile unsigned int* mock_register(unsigned int* reg)
+{
+    mock_time_ns += MOCK_ACCESS_NS;
+    mock_settle();
+    return (volatile unsigned int*) reg;
+}
+
+/*
+ * Ler o RXBUF libera o próximo byte (o USCI segura o SCL enquanto o RXBUF está cheio).
+ */
+unsigned int mock_ucb0_rxbuf()
+{
+    byte value;
+    mock_time_ns += MOCK_ACCESS_NS;
+    mock_settle();
+    value = mock_rxbuf;
+    mock_ucb0.ifg &= ~UCRXIFG;
+
+    if (mock_bus_state == MOCK_BUS_RX && mock_bus_event == MOCK_EVENT_NONE) {
+        mock_bus_schedule(MOCK_EVENT_RX_BYTE, mock_time_ns, 9);
+    }
+    return value;
+}
+
+unsigned int mock_ucb0_iv()
+{
+    unsigned int pending;
+    mock_time_ns += MOCK_ACCESS_NS;
+    mock_settle();
+    pending = mock_ucb0.ifg & mock_ucb0.ie;
+
+    if (pending & UCNACKIFG) {
+        mock_ucb0.ifg &= ~UCNACKIFG;
+        return 4;
+    }
+    if (pending & UCRXIFG) {
+        mock_ucb0.ifg &= ~UCRXIFG;
+        return 10;
+    }
+    if (pending & UCTXIFG) {
+        mock_ucb0.ifg &= ~UCTXIFG;
+        return 12;
+    }
+    return 0;
+}
+
+// Interrupções e LPM0 =================================================================
+bool mock_timer_armed()
+{
+    return (mock_tb0.ctl & MC_1) && (mock_tb0.cctl0 & CCIE);
+}
+
+unsigned long long mock_timer_deadline()
+{
+    return mock_timer_start_ns + (unsigned long long) mock_tb0.ccr0 * MOCK_ACLK_NS;
+}
+
+void mock_run_isr(void (*isr)(void))
+{
+    mock_in_isr = true;
+    mock_gie = false;
+    isr();
+    mock_gie = true;
+    mock_in_isr = false;
+}
+
+/*
+ * Pula o tempo até o próximo evento do barramento ou do timer, se ele vem antes de limit.
+ */
+bool mock_advance(unsigned long long limit)
+{
+    unsigned long long next = limit;
+    if (mock_bus_event != MOCK_EVENT_NONE && mock_bus_due_ns < next) next = mock_bus_due_ns;
+    if (mock_timer_armed() && mock_timer_deadline() < next) next = mock_timer_deadline();
+    if (next == limit || next <= mock_time_ns) return false;
+    mock_time_ns = next;
+    mock_settle();
+    return true;
+}
+
+/*
+ * Roda as interrupções pendentes (com GIE). Devolve true se alguma rodou.
+ */
+bool mock_deliver()
+{
+    bool ran = false;
+    while (mock_gie && !mock_in_isr) {
+        mock_settle();
+        if (mock_ucb0.ifg & mock_ucb0.ie & (UCNACKIFG | UCRXIFG | UCTXIFG)) {
+            mock_run_isr(__ucb0_lcd_interrupt);
+        } else if (mock_timer_armed() && mock_time_ns >= mock_timer_deadline()) {
+            mock_run_isr(__lcd_wait_timer_handle);
+        } else {
+            break;
+        }
+        ran = true;
+    }
+    return ran;
+}
+
+unsigned short __get_interrupt_state()
+{
+    return mock_gie? GIE : 0;
+}
+
+void __set_interrupt_state(unsigned short state)
+{
+    mock_gie = (state & GIE) != 0;
+    mock_deliver();
+}
+
+void __enable_interrupt()
+{
+    mock_gie = true;
+    mock_deliver();
+}
+
+void __disable_interrupt()
+{
+    mock_gie = false;
+}
+
+/*
+ * LPM0 com GIE: roda interrupções até uma delas pedir para acordar. Sem nada pendente, o
+ * tempo pula para o próximo evento do barramento ou do timer; sem nenhum, ninguém mais
+ * acordaria a CPU.
+ */
+void __bis_SR_register(unsigned short bits)
+{
+    if (!(bits & GIE)) {
+        fprintf(stderr, "LPM sem GIE\n");
+        exit(1);
+    }
+    mock_gie = true;
+    mock_wake = false;
+    while (!mock_wake) {
+        if (mock_deliver()) continue;
+        if (mock_advance(~0ULL)) continue;
+        fprintf(stderr, "LPM0 sem interrupção pendente: o driver travou (cauda %u, cabeça %u, passo %u)\n",
+                lcd_queue_tail, lcd_queue_head, lcd_strobe_step);
+        exit(1);
+    }
+}
+
+void __bic_SR_register_on_exit(unsigned short bits)
+{
+    if (bits & LPM0_bits) mock_wake = true;
+}
+
+/*
+ * A espera roda as interrupções no instante em que elas aconteceriam.
+ */
+void delay_us(unsigned int time_us)
+{
+    unsigned long long end = mock_time_ns + time_us * 1000ULL;
+    while (1) {
+        mock_deliver();
+        if (!mock_advance(end)) break;
+    }
+    mock_time_ns = end;
+}
+
+#endif /* LCD_BUS_MODEL_H_ */
@@ -0,0 +1,242 @@
+/*
+ * lcd_test.c
+ *
+ * Testes no PC do driver de Common/lcd.h contra o modelo de lcd_bus_model.h (UCB0, TB0,
+ * PCF8574 + HD44780). Cada teste confere o que ficou na tela, que o HD44780 nunca recebeu
+ * uma instrução ainda ocupado, que lcd_stats bate com o que o modelo viu no barramento e
+ * um teto de custo (transações, bytes, esperas).
+ *
+ * Compilado duas vezes pelo Makefile: lcd_test (LCD_USE_BUSY_FLAG = 1, padrão) e
+ * lcd_test_timer (LCD_USE_BUSY_FLAG = 0, só o timer nas esperas longas).
+ *
+ * Os tempos impressos são do modelo (SCL, tempos do datasheet, 1 us por acesso a
+ * registrador), não medidas na placa. lcd_test -v imprime cada evento do barramento.
+ */
+
+#include <msp430.h>
+#include <inttypes.h>
+#include <stdio.h>
+
+// Mesmos parâmetros do Exp7/main.c
+#define ACLK_HZ 32768UL
+#define SMCLK_HZ 1048576UL
+#include "../Common/clocks.h"
+
+#define LCD_I2C_SCL_HZ 100000UL
+
+typedef uint8_t bool;
+const bool true = 1;
+const bool false = 0;
+
+typedef uint8_t byte;
+
+void delay_us(unsigned int time_us);
+
+#include "../Common/lcd.h"
+#include "lcd_bus_model.h"
+
+#define TEST_ADDRESS LCD_I2C_ADDRESS
+#define TEST_SECOND_ADDRESS (LCD_I2C_ADDRESS - 1)
+#define TEST_ABSENT_ADDRESS (LCD_I2C_ADDRESS - 2)
+
+unsigned int test_failures = 0;
+MockBusStats test_bus_start;
+unsigned long long test_time_start;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("  FALHA (linha %d): %s\n", __LINE__, #cond); \
+            test_failures++; \
+        } \
+    } while (0)
+
+void test_begin(const char* name)
+{
+    printf("%s\n", name);
+    lcd_stats_reset();
+    test_bus_start = mock_bus;
+    test_time_start = mock_time_ns;
+}
+
+/*
+ * Confere lcd_stats contra o barramento do modelo e imprime o custo do teste.
+ */
+void test_end()
+{
+    unsigned long transactions = mock_bus.transactions - test_bus_start.transactions;
+    unsigned long bytes = mock_bus.bytes - test_bus_start.bytes;
+    unsigned int i;
+
+    printf("  %lu transações, %lu bytes, %lu ops, delay_us %lu, timer %lu ticks, %.2f ms\n",
+           lcd_stats.transactions, lcd_stats.bytes, lcd_stats.ops, lcd_stats.delay_us,
+           lcd_stats.wait_ticks, (mock_time_ns - test_time_start) / 1e6);
+
+    CHECK(lcd_stats.transactions == transactions);
+    CHECK(lcd_stats.bytes == bytes);
+    for (i = 0; i < mock_lcd_count; i++) {
+        CHECK(mock_lcds[i].busy_violations == 0);
+    }
+}
+
+void check_row(MockLcd* model, byte row, const char* expected)
+{
+    char text[LCD_COLS + 1];
+    mock_lcd_row(model, row, text);
+    if (strcmp(text, expected) != 0) {
+        printf("  FALHA: linha %u \"%s\", esperado \"%s\"\n", row, text, expected);
+        test_failures++;
+    }
+}
+
+void set_row(LCD* lcd, byte row, const char* text)
+{
+    byte col;
+    for (col = 0; col < LCD_COLS; col++) {
+        lcd->buffer[row][col] = text[col];
+    }
+}
+
+int main(int argc, char** argv)
+{
+    static const char blank[] = "                ";
+    static const byte glyph[8] = { 0x04, 0x0E, 0x1F, 0xE4, 0x04, 0x04, 0x04, 0x00 };
+    MockLcd* model = mock_lcd_add(TEST_ADDRESS, true);
+    MockLcd* second_model = mock_lcd_add(TEST_SECOND_ADDRESS, true);
+    LCD lcd, second, absent;
+    unsigned long ops, nacks;
+    unsigned int i;
+    char text[LCD_COLS + 1];
+
+    mock_trace = argc > 1 && strcmp(argv[1], "-v") == 0;
+    printf("LCD_USE_BUSY_FLAG = %d, SCL %lu Hz\n", LCD_USE_BUSY_FLAG,
+           I2C_ACHIEVED_SCL(SMCLK_HZ, LCD_I2C_SCL_HZ));
+    __enable_interrupt();
+
+    test_begin("initialize_lcd");
+    lcd = initialize_lcd(TEST_ADDRESS);
+    lcd_wait_idle();
+    test_end();
+    CHECK(model->four_bit && model->two_lines && model->display_on);
+    CHECK(model->increment && !model->entry_shift);
+    check_row(model, 0, blank);
+    check_row(model, 1, blank);
+    CHECK(lcd_stats.delay_us == LCD_DELAY_POWER_ON_US + LCD_DELAY_INIT_FIRST_US + LCD_DELAY_INIT_SECOND_US);
+    CHECK(lcd_stats.ops == 5);
+
+    test_begin("lcd_flush, tela inteira");
+    set_row(&lcd, 0, "Hello, world! :)");
+    set_row(&lcd, 1, "0123456789ABCDEF");
+    lcd_flush(&lcd);
+    lcd_wait_idle();
+    test_end();
+    check_row(model, 0, "Hello, world! :)");
+    check_row(model, 1, "0123456789ABCDEF");
+    // Só o segundo cursor (o clear deixou o primeiro em (0, 0)), numa transação
+    CHECK(lcd_stats.ops == LCD_ROWS * LCD_COLS + 1);
+    CHECK(lcd_stats.transactions == 1);
+    CHECK(lcd_stats.bytes == 6 * lcd_stats.ops);
+    // No máximo um tick de timer: o STOP do teste anterior ainda saindo quando a fila recomeça
+    CHECK(lcd_stats.delay_us == 0 && lcd_stats.wait_ticks <= 1);
+
+    test_begin("lcd_flush sem mudança");
+    lcd_flush(&lcd);
+    lcd_wait_idle();
+    test_end();
+    CHECK(lcd_stats.ops == 0 && lcd_stats.transactions == 0 && lcd_stats.bytes == 0);
+
+    test_begin("lcd_flush, um caractere");
+    lcd.buffer[1][5] = 'x';
+    lcd_flush(&lcd);
+    lcd_wait_idle();
+    test_end();
+    check_row(model, 1, "01234x6789ABCDEF");
+    CHECK(lcd_stats.ops == 2);
+    CHECK(lcd_stats.transactions == 1 && lcd_stats.bytes == 12);
+
+    test_begin("lcd_clear");
+    lcd_clear(&lcd);
+    lcd_wait_idle();
+    test_end();
+    check_row(model, 0, blank);
+    check_row(model, 1, blank);
+    CHECK(lcd_stats.ops == 1);
+    // (+1 tick se o STOP anterior ainda estava saindo)
+#if LCD_USE_BUSY_FLAG
+    // BF lido pelo barramento; o timer só entra se o BF não baixar em LCD_BUSY_MAX_POLLS
+    CHECK(lcd_stats.wait_ticks < LCD_DELAY_CLEAR_HOME_TICKS);
+#else
+    CHECK(lcd_stats.wait_ticks >= LCD_DELAY_CLEAR_HOME_TICKS && lcd_stats.wait_ticks <= LCD_DELAY_CLEAR_HOME_TICKS + 1);
+#endif
+
+    // 10 redesenhos sem esperar: a fila enche e lcd_queue_push dorme até a ISR liberar espaço
+    test_begin("fila cheia");
+    for (i = 0; i < 10; i++) {
+        memset(text, '0' + i, LCD_COLS);
+        set_row(&lcd, 0, text);
+        set_row(&lcd, 1, text);
+        lcd_flush(&lcd);
+    }
+    lcd_wait_idle();
+    test_end();
+    CHECK(lcd_stats.ops > LCD_QUEUE_SIZE);
+    check_row(model, 0, "9999999999999999");
+    check_row(model, 1, "9999999999999999");
+    CHECK(lcd_stats.bytes == 6 * lcd_stats.ops);
+
+    test_begin("lcd_define_glyph");
+    lcd_define_glyph(&lcd, 1, glyph);
+    lcd.buffer[0][0] = 1;
+    lcd_flush(&lcd);
+    lcd_wait_idle();
+    test_end();
+    for (i = 0; i < 8; i++) {
+        CHECK(model->cgram[8 + i] == (glyph[i] & 0x1F));
+    }
+    CHECK(model->ddram[0] == 1);
+    CHECK(lcd_stats.ops == 1 + 8 + 2);
+
+    test_begin("lcd_shift_display e lcd_return_home");
+    lcd_shift_display(&lcd, true);
+    lcd_wait_idle();
+    mock_lcd_row(model, 1, text);
+    CHECK(strcmp(text, "999999999999999 ") == 0);
+    lcd_return_home(&lcd);
+    lcd_wait_idle();
+    test_end();
+    check_row(model, 1, "9999999999999999");
+
+    // Dois displays e um endereço sem backpack (NACK): os ops do ausente são descartados
+    // e os outros dois continuam na mesma fila, trocando de endereço com repeated START
+    test_begin("vários displays, um ausente");
+    nacks = lcd_nacks;
+    second = initialize_lcd(TEST_SECOND_ADDRESS);
+    absent = initialize_lcd(TEST_ABSENT_ADDRESS);
+    set_row(&lcd, 0, "display 0x27    ");
+    set_row(&second, 0, "display 0x26    ");
+    set_row(&absent, 0, "display 0x25    ");
+    ops = lcd_bus_switches;
+    for (i = 0; i < LCD_COLS; i++) {
+        lcd.buffer[1][i] = 'a' + i;
+        second.buffer[1][i] = 'A' + i;
+        absent.buffer[1][i] = '0' + i;
+        lcd_flush(&lcd);
+        lcd_flush(&second);
+        lcd_flush(&absent);
+    }
+    lcd_wait_idle();
+    test_end();
+    check_row(model, 0, "display 0x27    ");
+    check_row(model, 1, "abcdefghijklmnop");
+    check_row(second_model, 0, "display 0x26    ");
+    check_row(second_model, 1, "ABCDEFGHIJKLMNOP");
+    CHECK(lcd_nacks > 0);
+    CHECK(lcd_bus_switches > ops);
+    CHECK(mock_bus.nacks - test_bus_start.nacks >= lcd_nacks - nacks);
+
+    if (test_failures) {
+        printf("%u falhas\n", test_failures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
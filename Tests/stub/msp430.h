@@ -0,0 +1,94 @@
+/*
+ * msp430.h (stub para os testes no PC)
+ *
+ * Só o que os headers de Common/ usam: bits, constantes dos registradores e as intrínsecas.
+ * Os registradores do UCB0 e do TB0 e as intrínsecas de interrupção/LPM só são declarados
+ * aqui: quem os usa inclui o modelo que os implementa (lcd_bus_model.h). Cada acesso a um
+ * desses registradores passa por mock_register, que antes avança o periférico com o que
+ * foi escrito desde o último acesso.
+ */
+
+#ifndef MSP430_STUB_H_
+#define MSP430_STUB_H_
+
+#define BIT0 0x0001
+#define BIT1 0x0002
+#define BIT2 0x0004
+#define BIT3 0x0008
+#define BIT4 0x0010
+#define BIT5 0x0020
+#define BIT6 0x0040
+#define BIT7 0x0080
+
+// USCI_A
+#define UCOS16 0x01
+#define UCPEN 0x80
+#define UCPAR 0x40
+#define UCSPB 0x08
+
+// USCI_B (I2C)
+#define UCTR 0x10
+#define UCTXNACK 0x08
+#define UCTXSTP 0x04
+#define UCTXSTT 0x02
+#define UCSWRST 0x01
+#define UCNACKIFG 0x20
+#define UCTXIFG 0x02
+#define UCRXIFG 0x01
+#define UCNACKIE 0x20
+#define UCTXIE 0x02
+#define UCRXIE 0x01
+
+// Timer_B
+#define TBSSEL__ACLK 0x0100
+#define MC_0 0x0000
+#define MC_1 0x0010
+#define TBCLR 0x0004
+#define CCIE 0x0010
+
+// Status register
+#define GIE 0x0008
+#define LPM0_bits 0x0010
+
+typedef struct {
+    unsigned int ctl1;
+    unsigned int i2csa;
+    unsigned int ie;
+    unsigned int ifg;
+    unsigned int txbuf;     // MOCK_TXBUF_EMPTY enquanto o modelo não recebeu uma escrita
+} MockUcb0;
+
+typedef struct {
+    unsigned int ctl;
+    unsigned int cctl0;
+    unsigned int ccr0;
+} MockTimer;
+
+extern MockUcb0 mock_ucb0;
+extern MockTimer mock_tb0;
+volatile unsigned int* mock_register(unsigned int* reg);
+unsigned int mock_ucb0_iv();
+unsigned int mock_ucb0_rxbuf();
+
+#define UCB0CTL1 (*mock_register(&mock_ucb0.ctl1))
+#define UCB0I2CSA (*mock_register(&mock_ucb0.i2csa))
+#define UCB0IE (*mock_register(&mock_ucb0.ie))
+#define UCB0IFG (*mock_register(&mock_ucb0.ifg))
+#define UCB0TXBUF (*mock_register(&mock_ucb0.txbuf))
+#define UCB0RXBUF mock_ucb0_rxbuf()
+#define UCB0IV mock_ucb0_iv()
+#define TB0CTL (*mock_register(&mock_tb0.ctl))
+#define TB0CCTL0 (*mock_register(&mock_tb0.cctl0))
+#define TB0CCR0 (*mock_register(&mock_tb0.ccr0))
+
+unsigned short __get_interrupt_state();
+void __set_interrupt_state(unsigned short state);
+void __enable_interrupt();
+void __disable_interrupt();
+void __bis_SR_register(unsigned short bits);
+void __bic_SR_register_on_exit(unsigned short bits);
+
+#define __interrupt
+#define __even_in_range(value, range) (value)
+
+#endif /* MSP430_STUB_H_ */
@@ -0,0 +1,399 @@
+/*
+ * uart_model.c
+ *
+ * Modelo do auto-teste de loopback do Exp6 (UART_SELF_TEST): para cada baud rate e formato,
+ * os divisores que o firmware grava (mesmas macros de clocks.h), o baud obtido, o erro em
+ * relação ao nominal e o resultado esperado do quadro de relatório.
+ *
+ * O baud obtido não vem de UART_ACHIEVED_BAUD: o modelo decodifica UCBRx e UCAxMCTL
+ * (UCOS16, UCBRSx, UCBRFx) e soma os ciclos de BRCLK de cada bit como a USCI faz
+ * (SLAU208, "Transmit Bit Timing"). A macro é conferida contra essa simulação.
+ *
+ * O TX e o RX usam o mesmo SMCLK e os mesmos divisores, então o loopback não tem erro de
+ * baud: o esperado é zero erros de paridade/framing/overrun e zero bytes diferentes.
+ * O erro em relação ao nominal só importa para quem está do outro lado (o PC lendo a UCA0).
+ *
+ * Uso:
+ *   uart_model             imprime a tabela e confere o próprio decodificador
+ *   uart_model captura     decodifica os quadros de relatório de uma captura da UCA0
+ *                          (bytes em hexadecimal separados por espaço) e compara com o modelo
+ */
+
+#include <msp430.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Mesmos parâmetros do Exp6/main.c
+#define SMCLK_HZ 4000000UL
+#include "../Common/clocks.h"
+
+#define SELF_TEST_BYTES 256
+#define SELF_TEST_TIMER_HZ (SMCLK_HZ / 8)
+#define SELF_TEST_REPORT_LENGTH 15
+#define FRAME_SYNC 0x7E
+
+// Tolerância do bytes/s medido: o laço de polling e a quantização do TA1
+#define MODEL_RATE_TOLERANCE_PERMILLE 10
+// Erro máximo do baud obtido em relação ao nominal (o PC do outro lado da UCA0)
+#define MODEL_BAUD_TOLERANCE_PERMILLE 10
+
+int model_verbose = 1;
+
+// Registradores que o firmware grava para cada baud
+typedef struct {
+    uint32_t baud;
+    unsigned int br;
+    uint8_t mctl;
+} UartBaudModel;
+
+typedef struct {
+    const char* name;
+    uint8_t bits_per_char;
+} UartFormatModel;
+
+#define MODEL_BAUD(baud) { baud, UART_BR(SMCLK_HZ, baud), UART_MCTL(SMCLK_HZ, baud) }
+const UartBaudModel model_bauds[] = {
+    MODEL_BAUD(9600UL),
+    MODEL_BAUD(19200UL),
+    MODEL_BAUD(38400UL),
+    MODEL_BAUD(57600UL),
+    MODEL_BAUD(115200UL),
+};
+#define MODEL_BAUD_COUNT (sizeof(model_bauds) / sizeof(model_bauds[0]))
+
+const UartFormatModel model_formats[] = {
+    { "8N1", 10 },
+    { "8E1", 11 },
+    { "8O2", 12 },
+};
+#define MODEL_FORMAT_COUNT (sizeof(model_formats) / sizeof(model_formats[0]))
+#define MODEL_CONFIG_COUNT (MODEL_BAUD_COUNT * MODEL_FORMAT_COUNT)
+
+typedef struct {
+    uint16_t baud_div100;
+    uint16_t bytes_per_s;
+    uint16_t expected_bytes_per_s;
+    uint16_t parity_errors;
+    uint16_t framing_errors;
+    uint16_t overruns;
+    uint16_t mismatches;
+} UartReport;
+
+/*
+ * Padrões de modulação do UCBRSx (SLAU208, tabela "BITCLK Modulation Pattern"):
+ * o bit i do padrão diz se o bit i do caractere (0 = start, repete a cada 8) ganha um
+ * ciclo (UCOS16 = 0) ou um UCBRx (UCOS16 = 1) a mais.
+ */
+const uint8_t usci_ucbrs_pattern[8] = { 0x00, 0x02, 0x22, 0x2A, 0xAA, 0xAE, 0xEE, 0xFE };
+
+/*
+ * Ciclos de BRCLK do bit i de um caractere:
+ *   UCOS16 = 0: UCBRx + m_UCBRSx[i]
+ *   UCOS16 = 1: (16 + m_UCBRSx[i]) * UCBRx + UCBRFx (UCBRFx dos 16 BITCLK16 ganham um ciclo)
+ */
+uint32_t usci_bit_cycles(unsigned int br, uint8_t mctl, unsigned int bit)
+{
+    unsigned int brs = (mctl >> 1) & 0x07;
+    unsigned int brf = (mctl >> 4) & 0x0F;
+    unsigned int m = (usci_ucbrs_pattern[brs] >> (bit & 0x07)) & 1;
+
+    if (mctl & UCOS16) {
+        return (16UL + m) * br + brf;
+    }
+    return br + m;
+}
+
+// Ciclos de BRCLK de um caractere inteiro: o padrão recomeça no start bit
+uint32_t usci_char_cycles(const UartBaudModel* baud, unsigned int bits_per_char)
+{
+    uint32_t cycles = 0;
+    unsigned int bit;
+    for (bit = 0; bit < bits_per_char; bit++) {
+        cycles += usci_bit_cycles(baud->br, baud->mctl, bit);
+    }
+    return cycles;
+}
+
+// Baud médio de um período inteiro do padrão (8 bits)
+uint32_t usci_achieved_baud(const UartBaudModel* baud)
+{
+    return (uint32_t) ((8ULL * SMCLK_HZ) / usci_char_cycles(baud, 8));
+}
+
+/*
+ * O que o firmware deveria relatar para a configuração index. O TX escreve o próximo byte
+ * assim que o buffer esvazia, então os SELF_TEST_BYTES caracteres saem colados: a medida
+ * é o tempo de SELF_TEST_BYTES caracteres simulados, em ticks inteiros do TA1.
+ */
+UartReport model_report(unsigned int index)
+{
+    const UartBaudModel* baud = &model_bauds[index / MODEL_FORMAT_COUNT];
+    const UartFormatModel* format = &model_formats[index % MODEL_FORMAT_COUNT];
+    UartReport report;
+    uint32_t ticks = CLOCK_DIV_CEIL((uint64_t) SELF_TEST_BYTES * usci_char_cycles(baud, format->bits_per_char) *
+                                    SELF_TEST_TIMER_HZ, SMCLK_HZ);
+
+    memset(&report, 0, sizeof(report));
+    report.baud_div100 = baud->baud / 100;
+    report.bytes_per_s = ((uint32_t) SELF_TEST_BYTES * SELF_TEST_TIMER_HZ) / ticks;
+    report.expected_bytes_per_s = baud->baud / format->bits_per_char;
+    return report;
+}
+
+/*
+ * Um passo do módulo CRC escrevendo em CRCDI_L: CRC16-CCITT (0x1021) com os bits de cada
+ * byte entrando do bit 0 para o 7 (o CRCDIRB_L daria o CCITT da ordem normal).
+ */
+uint16_t crc16_step(uint16_t crc, uint8_t byte)
+{
+    int i;
+    for (i = 0; i < 8; i++) {
+        unsigned int feedback = ((crc >> 15) ^ (byte >> i)) & 1;
+        crc <<= 1;
+        if (feedback) crc ^= 0x1021;
+    }
+    return crc;
+}
+
+void encode_report(const UartReport* report, uint8_t index, uint8_t* payload)
+{
+    const uint16_t fields[] = {
+        report->baud_div100, report->bytes_per_s, report->expected_bytes_per_s,
+        report->parity_errors, report->framing_errors, report->overruns, report->mismatches
+    };
+    unsigned int i;
+    payload[0] = index;
+    for (i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        payload[1 + 2 * i] = fields[i] >> 8;
+        payload[2 + 2 * i] = fields[i] & 0xFF;
+    }
+}
+
+UartReport decode_report(const uint8_t* payload)
+{
+    UartReport report;
+    report.baud_div100 = (payload[1] << 8) | payload[2];
+    report.bytes_per_s = (payload[3] << 8) | payload[4];
+    report.expected_bytes_per_s = (payload[5] << 8) | payload[6];
+    report.parity_errors = (payload[7] << 8) | payload[8];
+    report.framing_errors = (payload[9] << 8) | payload[10];
+    report.overruns = (payload[11] << 8) | payload[12];
+    report.mismatches = (payload[13] << 8) | payload[14];
+    return report;
+}
+
+/*
+ * Monta [SYNC] [LEN] [payload] [CRC alto] [CRC baixo] como o uart_uca0_send_frame.
+ */
+unsigned int encode_frame(const uint8_t* payload, uint8_t length, uint8_t* frame)
+{
+    uint16_t crc = crc16_step(0xFFFF, length);
+    unsigned int i;
+    frame[0] = FRAME_SYNC;
+    frame[1] = length;
+    for (i = 0; i < length; i++) {
+        frame[2 + i] = payload[i];
+        crc = crc16_step(crc, payload[i]);
+    }
+    frame[2 + length] = crc >> 8;
+    frame[3 + length] = crc & 0xFF;
+    return length + 4;
+}
+
+/*
+ * Compara um relatório com o modelo. Devolve o número de diferenças.
+ */
+unsigned int check_report(uint8_t index, const UartReport* measured)
+{
+    UartReport expected;
+    unsigned int failures = 0;
+    long rate_error;
+
+    if (index >= MODEL_CONFIG_COUNT) {
+        printf("  relatório %u: índice fora da varredura\n", index);
+        return 1;
+    }
+    expected = model_report(index);
+    rate_error = CLOCK_ERROR_PERMILLE(measured->bytes_per_s, expected.bytes_per_s);
+
+    if (model_verbose) {
+        printf("  %2u %6u %s: %5u bytes/s (modelo %5u, %+ld‰) PE %u FE %u OE %u dif %u",
+               index, measured->baud_div100 * 100, model_formats[index % MODEL_FORMAT_COUNT].name,
+               measured->bytes_per_s, expected.bytes_per_s, rate_error, measured->parity_errors,
+               measured->framing_errors, measured->overruns, measured->mismatches);
+    }
+
+    if (measured->baud_div100 != expected.baud_div100) failures++;
+    if (measured->expected_bytes_per_s != expected.expected_bytes_per_s) failures++;
+    if (rate_error > MODEL_RATE_TOLERANCE_PERMILLE || rate_error < -MODEL_RATE_TOLERANCE_PERMILLE) failures++;
+    if (measured->parity_errors || measured->framing_errors || measured->overruns || measured->mismatches) failures++;
+
+    if (model_verbose) {
+        printf(failures? "  <-- FALHA\n" : "\n");
+    }
+    return failures;
+}
+
+/*
+ * Procura quadros de relatório num fluxo de bytes. Quadros com outro tamanho são do
+ * protocolo normal do experimento e são ignorados; CRC errado conta como falha e em
+ * crc_errors.
+ */
+unsigned int check_stream(const uint8_t* data, unsigned int length, unsigned int* reports,
+                          unsigned int* crc_errors)
+{
+    unsigned int failures = 0;
+    unsigned int i = 0;
+    *reports = 0;
+    *crc_errors = 0;
+
+    while (i + 4 <= length) {
+        if (data[i] != FRAME_SYNC || i + 4 + data[i + 1] > length) {
+            i++;
+            continue;
+        }
+
+        uint8_t frame_length = data[i + 1];
+        const uint8_t* payload = &data[i + 2];
+        uint16_t crc = crc16_step(0xFFFF, frame_length);
+        unsigned int j;
+        for (j = 0; j < frame_length; j++) {
+            crc = crc16_step(crc, payload[j]);
+        }
+        if (crc != ((payload[frame_length] << 8) | payload[frame_length + 1])) {
+            if (frame_length == SELF_TEST_REPORT_LENGTH) {
+                if (model_verbose) {
+                    printf("  quadro em %u: CRC errado\n", i);
+                }
+                (*crc_errors)++;
+                failures++;
+            }
+            i++;
+            continue;
+        }
+
+        if (frame_length == SELF_TEST_REPORT_LENGTH) {
+            UartReport report = decode_report(payload);
+            failures += check_report(payload[0], &report);
+            (*reports)++;
+        }
+        i += frame_length + 4;
+    }
+    return failures;
+}
+
+void print_model()
+{
+    unsigned int b, f;
+    printf("SMCLK %lu Hz, %u bytes por configuração, TA1 = SMCLK / 8\n", SMCLK_HZ, SELF_TEST_BYTES);
+    printf(" baud    UCBRx MCTL  obtido  erro | bytes/s 8N1  8E1  8O2\n");
+    for (b = 0; b < MODEL_BAUD_COUNT; b++) {
+        const UartBaudModel* baud = &model_bauds[b];
+        uint32_t achieved = usci_achieved_baud(baud);
+        printf("%6lu  %5u 0x%02X %7lu %+3ld‰ |",
+               (unsigned long) baud->baud, baud->br, baud->mctl, (unsigned long) achieved,
+               CLOCK_ERROR_PERMILLE(achieved, baud->baud));
+        for (f = 0; f < MODEL_FORMAT_COUNT; f++) {
+            printf(" %5u", model_report(b * MODEL_FORMAT_COUNT + f).bytes_per_s);
+        }
+        printf("\n");
+    }
+}
+
+/*
+ * Sem captura: o baud simulado tem que bater com UART_ACHIEVED_BAUD e ficar dentro da
+ * tolerância, e o decodificador tem que aceitar os quadros que o modelo produz e recusar
+ * um quadro com um bit trocado.
+ */
+int self_check()
+{
+    uint8_t stream[MODEL_CONFIG_COUNT * (SELF_TEST_REPORT_LENGTH + 4) + 1];
+    uint8_t payload[SELF_TEST_REPORT_LENGTH];
+    unsigned int length = 0, reports, failures, crc_errors, i;
+    const uint8_t check_string[] = "123456789";
+    uint16_t crc = 0xFFFF;
+
+    // Ordem de bits do CRCDI: CCITT dos bytes espelhados. Para "123456789", 0x29B1 seria o
+    // CCITT na ordem normal (CRCDIRB).
+    for (i = 0; i < 9; i++) {
+        crc = crc16_step(crc, check_string[i]);
+    }
+    printf("CRC do módulo (CRCDI) sobre \"123456789\": 0x%04X\n", crc);
+
+    // Macro de clocks.h contra a simulação (± 1 do arredondamento da divisão)
+    const uint32_t macro_achieved[MODEL_BAUD_COUNT] = {
+        UART_ACHIEVED_BAUD(SMCLK_HZ, 9600UL), UART_ACHIEVED_BAUD(SMCLK_HZ, 19200UL),
+        UART_ACHIEVED_BAUD(SMCLK_HZ, 38400UL), UART_ACHIEVED_BAUD(SMCLK_HZ, 57600UL),
+        UART_ACHIEVED_BAUD(SMCLK_HZ, 115200UL),
+    };
+    failures = 0;
+    for (i = 0; i < MODEL_BAUD_COUNT; i++) {
+        uint32_t achieved = usci_achieved_baud(&model_bauds[i]);
+        long error = CLOCK_ERROR_PERMILLE(achieved, model_bauds[i].baud);
+        if (achieved + 1 < macro_achieved[i] || achieved > macro_achieved[i] + 1) {
+            printf("FALHA: %lu baud simulado %lu, UART_ACHIEVED_BAUD %lu\n", (unsigned long) model_bauds[i].baud,
+                   (unsigned long) achieved, (unsigned long) macro_achieved[i]);
+            failures++;
+        }
+        if (error > MODEL_BAUD_TOLERANCE_PERMILLE || error < -MODEL_BAUD_TOLERANCE_PERMILLE) {
+            printf("FALHA: %lu baud com erro de %+ld‰\n", (unsigned long) model_bauds[i].baud, error);
+            failures++;
+        }
+    }
+    if (failures) {
+        return 1;
+    }
+
+    for (i = 0; i < MODEL_CONFIG_COUNT; i++) {
+        UartReport report = model_report(i);
+        encode_report(&report, i, payload);
+        length += encode_frame(payload, SELF_TEST_REPORT_LENGTH, &stream[length]);
+    }
+    printf("Relatórios gerados pelo modelo:\n");
+    failures = check_stream(stream, length, &reports, &crc_errors);
+    if (failures || crc_errors || reports != MODEL_CONFIG_COUNT) {
+        printf("FALHA: %u relatórios, %u diferenças\n", reports, failures);
+        return 1;
+    }
+
+    // Um bit trocado no payload do primeiro relatório: só ele cai, por CRC
+    stream[5] ^= 0x01;
+    model_verbose = 0;
+    failures = check_stream(stream, length, &reports, &crc_errors);
+    if (crc_errors != 1 || failures != 1 || reports != MODEL_CONFIG_COUNT - 1) {
+        printf("FALHA: quadro corrompido: %u erros de CRC, %u relatórios, %u diferenças\n",
+               crc_errors, reports, failures);
+        return 1;
+    }
+    printf("Quadro corrompido recusado pelo CRC\n");
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    print_model();
+
+    if (argc < 2) {
+        return self_check();
+    }
+
+    FILE* file = fopen(argv[1], "r");
+    if (!file) {
+        perror(argv[1]);
+        return 2;
+    }
+    static uint8_t data[65536];
+    unsigned int length = 0, value, reports, failures, crc_errors;
+    while (length < sizeof(data) && fscanf(file, "%x", &value) == 1) {
+        data[length++] = value;
+    }
+    fclose(file);
+
+    printf("Captura: %u bytes\n", length);
+    failures = check_stream(data, length, &reports, &crc_errors);
+    printf("%u relatórios de %u, %u diferenças (%u CRC errado)\n", reports, (unsigned int) MODEL_CONFIG_COUNT,
+           failures, crc_errors);
+    return (failures || reports == 0)? 1 : 0;
+}